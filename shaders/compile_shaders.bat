@@ -1,4 +1,9 @@
 @echo off
+rem meshlet_config.hlsli is written by CMake from MESHLET_MAX_VERTICES / MESHLET_MAX_TRIANGLES
+if not exist meshlet_config.hlsli (
+    echo meshlet_config.hlsli is missing, configure the project with CMake first
+    exit /b 1
+)
 dxc meshlet_as.hlsl -T as_6_6 -E as_main -Fo ../bin/meshlet_as.dxil
 dxc meshlet_ms.hlsl -T ms_6_6 -E ms_main -Fo ../bin/meshlet_ms.dxil
 dxc meshlet_ps.hlsl -T ps_6_6 -E ps_main -Fo ../bin/meshlet_ps.dxil
\ No newline at end of file
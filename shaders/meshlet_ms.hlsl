@@ -1,3 +1,5 @@
+#include "meshlet_config.hlsli"
+
 struct ASOutput {
     uint Dummy;
 };
@@ -13,7 +15,7 @@ cbuffer CameraConstants : register(b0) {
 
 [NumThreads(1, 1, 1)]
 [OutputTopology("triangle")]
-void ms_main(uint gtid: SV_GroupThreadID, uint gid: SV_GroupID, in payload ASOutput payload, out indices uint3 triangles[124], out vertices MSOutput vertices[64]) {
+void ms_main(uint gtid: SV_GroupThreadID, uint gid: SV_GroupID, in payload ASOutput payload, out indices uint3 triangles[MESHLET_MAX_TRIANGLES], out vertices MSOutput vertices[MESHLET_MAX_VERTICES]) {
     SetMeshOutputCounts(3, 1);
     triangles[0] = uint3(0, 1, 2);
 
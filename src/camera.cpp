@@ -10,12 +10,14 @@ namespace d3d12_mesh_shaders {
     static const float _SPEED = 12.5f;
     static const float _SENSITIVITY_X = 0.165f;
     static const float _SENSITIVITY_Y = 0.165f;
+    static const float _FIELD_OF_VIEW = 90.0f;
 
     camera::camera(const glm::vec3& position, const glm::vec3& rotation) noexcept
-        : _position(position), _rotation(rotation) {}
+        : _position(position), _rotation(rotation), _projection_scale(1.0f) {}
 
     void camera::update(float delta_time, uint32_t width, uint32_t height) noexcept {
-        const auto projection_matrix = util::reverse_depth_projection_matrix_lh(90.0f, static_cast<float>(width) / static_cast<float>(height), 0.1f, 1000.0f);
+        const auto projection_matrix = util::reverse_depth_projection_matrix_lh(_FIELD_OF_VIEW, static_cast<float>(width) / static_cast<float>(height), 0.1f, 1000.0f);
+        _projection_scale = static_cast<float>(height) / (2.0f * glm::tan(glm::radians(_FIELD_OF_VIEW) * 0.5f));
 
         const auto sin_pitch = glm::sin(_rotation.x);
         const auto cos_pitch = glm::cos(_rotation.x);
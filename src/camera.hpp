@@ -9,14 +9,25 @@ namespace d3d12_mesh_shaders {
         glm::vec3 _rotation;
 
         glm::mat4 _view_projection_matrix;
+
+        // viewport height in pixels over 2 tan(fov_y / 2): object space size over distance to pixels
+        float _projection_scale;
     public:
         camera(const glm::vec3& position, const glm::vec3& rotation) noexcept;
 
         void update(float delta_time, uint32_t width, uint32_t height) noexcept;
         void move_mouse(int delta_x, int delta_y) noexcept;
 
+        [[nodiscard]] inline const glm::vec3& get_position() const noexcept {
+            return _position;
+        }
+
         [[nodiscard]] inline const glm::mat4& get_view_projection_matrix() const noexcept {
             return _view_projection_matrix;
         }
+
+        [[nodiscard]] inline float get_projection_scale() const noexcept {
+            return _projection_scale;
+        }
     };
 }
\ No newline at end of file
@@ -0,0 +1,438 @@
+#include "cluster_lod.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace d3d12_mesh_shaders {
+    // clusters simplified together; four halved to two keeps the cluster count per level halving as well
+    static const size_t _LOD_GROUP_SIZE = 4;
+
+    // a group that keeps more of its triangles than this didn't simplify and is carried over instead
+    static const float _LOD_MIN_REDUCTION = 0.85f;
+
+    // meshopt_simplify's target error is relative to the group extent; the triangle target is what should stop it
+    static const float _LOD_MAX_ERROR = 1.0f;
+
+    static const size_t _LOD_GROUP_BATCH_SIZE = 4;
+
+    struct lod_work_cluster final {
+        // global vertex indices, three per triangle
+        std::vector<uint32_t> indices;
+        // sorted position ids of the vertices, see position_remap
+        std::vector<uint32_t> positions;
+        glm::vec3 center;
+        float radius;
+        float error;
+        uint32_t index;
+    };
+
+    struct lod_group_result final {
+        meshlet_build build;
+        glm::vec3 center;
+        float radius;
+        float error;
+        bool simplified;
+    };
+
+    // position id and the number of clusters of the level that have a vertex there
+    using position_count = std::pair<uint32_t, uint32_t>;
+
+    static void set_positions(lod_work_cluster& cluster, std::span<const uint32_t> position_remap) noexcept {
+        cluster.positions.resize(cluster.indices.size());
+        for(size_t i = 0; i < cluster.indices.size(); i++) {
+            cluster.positions[i] = position_remap[cluster.indices[i]];
+        }
+
+        std::sort(cluster.positions.begin(), cluster.positions.end());
+        cluster.positions.erase(std::unique(cluster.positions.begin(), cluster.positions.end()), cluster.positions.end());
+    }
+
+    static void set_sphere(lod_work_cluster& cluster, const std::vector<mesh::vertex>& vertices) noexcept {
+        auto min = glm::vec3(std::numeric_limits<float>::max()), max = glm::vec3(-std::numeric_limits<float>::max());
+        for(const auto index : cluster.indices) {
+            min = glm::min(min, vertices[index].position);
+            max = glm::max(max, vertices[index].position);
+        }
+
+        cluster.center = (min + max) * 0.5f;
+        cluster.radius = 0.0f;
+
+        for(const auto index : cluster.indices) {
+            cluster.radius = std::max(cluster.radius, glm::length(vertices[index].position - cluster.center));
+        }
+    }
+
+    // clusters start out as roots until their group simplifies
+    static inline mesh::lod_cluster root_cluster(const lod_work_cluster& cluster, uint32_t level) noexcept {
+        return mesh::lod_cluster {
+            .center = cluster.center,
+            .radius = cluster.radius,
+            .parent_center = cluster.center,
+            .parent_radius = cluster.radius,
+            .error = cluster.error,
+            .parent_error = std::numeric_limits<float>::max(),
+            .level = level
+        };
+    }
+
+    // appends one meshlet of source to build, keeping triangle_offset 4 byte aligned like meshopt_buildMeshlets does
+    static void append_meshlet(const uint32_t* meshlet_vertices, const uint8_t* meshlet_triangles, uint32_t vertex_count, uint32_t triangle_count,
+                               meshlet_build& build) noexcept {
+        build.triangles.resize((build.triangles.size() + 3) & ~size_t(3));
+
+        meshopt_Meshlet meshlet {};
+        meshlet.vertex_offset = static_cast<unsigned int>(build.vertices.size());
+        meshlet.triangle_offset = static_cast<unsigned int>(build.triangles.size());
+        meshlet.vertex_count = vertex_count;
+        meshlet.triangle_count = triangle_count;
+        build.meshlets.push_back(meshlet);
+
+        build.vertices.insert(build.vertices.end(), meshlet_vertices, meshlet_vertices + vertex_count);
+        build.triangles.insert(build.triangles.end(), meshlet_triangles, meshlet_triangles + triangle_count * 3);
+    }
+
+    // Groups each cluster with the ungrouped clusters sharing the most positions with the group so far, up to
+    // _LOD_GROUP_SIZE. A cluster left without ungrouped neighbours joins the neighbouring group it shares the most with.
+    static std::vector<std::vector<uint32_t>> group_clusters(const std::vector<lod_work_cluster>& clusters, const std::vector<position_count>& counts) noexcept {
+        // cluster pairs sharing a position, once per shared position
+        std::vector<std::pair<uint32_t, uint32_t>> position_clusters;
+        for(uint32_t i = 0; i < clusters.size(); i++) {
+            for(const auto position : clusters[i].positions) {
+                const auto count = std::lower_bound(counts.begin(), counts.end(), position_count(position, 0))->second;
+                if(count > 1) {
+                    position_clusters.emplace_back(position, i);
+                }
+            }
+        }
+
+        std::sort(position_clusters.begin(), position_clusters.end());
+
+        std::vector<std::pair<uint32_t, uint32_t>> pairs;
+        for(size_t begin = 0, end; begin < position_clusters.size(); begin = end) {
+            for(end = begin + 1; end < position_clusters.size() && position_clusters[end].first == position_clusters[begin].first; end++) {
+            }
+
+            for(auto i = begin; i < end; i++) {
+                for(auto j = begin; j < end; j++) {
+                    if(i != j) {
+                        pairs.emplace_back(position_clusters[i].second, position_clusters[j].second);
+                    }
+                }
+            }
+        }
+
+        std::sort(pairs.begin(), pairs.end());
+
+        // neighbours with their shared position count, per cluster
+        std::vector<std::vector<std::pair<uint32_t, uint32_t>>> neighbours(clusters.size());
+        for(size_t begin = 0, end; begin < pairs.size(); begin = end) {
+            for(end = begin + 1; end < pairs.size() && pairs[end] == pairs[begin]; end++) {
+            }
+
+            neighbours[pairs[begin].first].emplace_back(pairs[begin].second, static_cast<uint32_t>(end - begin));
+        }
+
+        std::vector<std::vector<uint32_t>> groups;
+        std::vector<uint32_t> cluster_groups(clusters.size(), ~0u);
+        std::vector<uint32_t> shared(clusters.size(), 0);
+
+        for(uint32_t seed = 0; seed < clusters.size(); seed++) {
+            if(cluster_groups[seed] != ~0u) {
+                continue;
+            }
+
+            const auto group_index = static_cast<uint32_t>(groups.size());
+            auto& group = groups.emplace_back();
+
+            std::vector<uint32_t> candidates;
+            for(auto cluster = seed; cluster != ~0u;) {
+                group.push_back(cluster);
+                cluster_groups[cluster] = group_index;
+
+                for(const auto& [neighbour, count] : neighbours[cluster]) {
+                    if(cluster_groups[neighbour] == ~0u) {
+                        if(shared[neighbour] == 0) {
+                            candidates.push_back(neighbour);
+                        }
+
+                        shared[neighbour] += count;
+                    }
+                }
+
+                cluster = ~0u;
+                if(group.size() < _LOD_GROUP_SIZE) {
+                    uint32_t best_shared = 0;
+                    for(const auto candidate : candidates) {
+                        if(cluster_groups[candidate] == ~0u && shared[candidate] > best_shared) {
+                            cluster = candidate;
+                            best_shared = shared[candidate];
+                        }
+                    }
+                }
+            }
+
+            for(const auto candidate : candidates) {
+                shared[candidate] = 0;
+            }
+        }
+
+        // fold lone clusters into the group of their best neighbour; a group of one can only keep its locked border
+        for(uint32_t i = 0; i < groups.size(); i++) {
+            if(groups[i].size() != 1) {
+                continue;
+            }
+
+            const auto cluster = groups[i][0];
+
+            auto best_group = ~0u;
+            uint32_t best_shared = 0;
+            for(const auto& [neighbour, count] : neighbours[cluster]) {
+                const auto group = cluster_groups[neighbour];
+                if(group != i && groups[group].size() > 1 && count > best_shared) {
+                    best_group = group;
+                    best_shared = count;
+                }
+            }
+
+            if(best_group != ~0u) {
+                groups[best_group].push_back(cluster);
+                cluster_groups[cluster] = best_group;
+                groups[i].clear();
+            }
+        }
+
+        std::erase_if(groups, [](const std::vector<uint32_t>& group) noexcept {
+            return group.empty();
+        });
+
+        return groups;
+    }
+
+    static void simplify_group(const mesh::meshlet_parameters& parameters, const std::vector<mesh::vertex>& vertices, std::span<const uint32_t> position_remap,
+                               const std::vector<lod_work_cluster>& clusters, const std::vector<uint32_t>& group, const std::vector<position_count>& counts,
+                               lod_group_result& result) noexcept {
+        std::vector<uint32_t> indices;
+        std::vector<uint32_t> group_positions;
+        for(const auto cluster : group) {
+            indices.insert(indices.end(), clusters[cluster].indices.begin(), clusters[cluster].indices.end());
+            group_positions.insert(group_positions.end(), clusters[cluster].positions.begin(), clusters[cluster].positions.end());
+        }
+
+        // the sphere and error only grow from the clusters of the group, so the parent error never projects smaller
+        auto min = glm::vec3(std::numeric_limits<float>::max()), max = glm::vec3(-std::numeric_limits<float>::max());
+        result.error = 0.0f;
+        for(const auto cluster : group) {
+            min = glm::min(min, clusters[cluster].center - clusters[cluster].radius);
+            max = glm::max(max, clusters[cluster].center + clusters[cluster].radius);
+            result.error = std::max(result.error, clusters[cluster].error);
+        }
+
+        result.center = (min + max) * 0.5f;
+        result.radius = 0.0f;
+        for(const auto cluster : group) {
+            result.radius = std::max(result.radius, glm::length(clusters[cluster].center - result.center) + clusters[cluster].radius);
+        }
+
+        // a position is on the group border when a cluster outside the group has a vertex there too
+        std::sort(group_positions.begin(), group_positions.end());
+
+        std::vector<uint32_t> border_positions;
+        for(size_t begin = 0, end; begin < group_positions.size(); begin = end) {
+            for(end = begin + 1; end < group_positions.size() && group_positions[end] == group_positions[begin]; end++) {
+            }
+
+            const auto count = std::lower_bound(counts.begin(), counts.end(), position_count(group_positions[begin], 0))->second;
+            if(count > end - begin) {
+                border_positions.push_back(group_positions[begin]);
+            }
+        }
+
+        std::vector<uint32_t> local_vertices(indices);
+        std::sort(local_vertices.begin(), local_vertices.end());
+        local_vertices.erase(std::unique(local_vertices.begin(), local_vertices.end()), local_vertices.end());
+
+        std::vector<uint32_t> local_indices(indices.size());
+        for(size_t i = 0; i < indices.size(); i++) {
+            local_indices[i] = static_cast<uint32_t>(std::lower_bound(local_vertices.begin(), local_vertices.end(), indices[i]) - local_vertices.begin());
+        }
+
+        std::vector<glm::vec3> positions(local_vertices.size());
+        for(size_t i = 0; i < local_vertices.size(); i++) {
+            positions[i] = vertices[local_vertices[i]].position;
+        }
+
+        const auto scale = meshopt_simplifyScale(&positions[0].x, positions.size(), sizeof(glm::vec3));
+
+        // The vendored meshopt_simplify has no option to lock the border. It does lock every vertex whose position is
+        // shared with a vertex that no triangle uses, so an unused copy of each border position locks it in place.
+        for(size_t i = 0; i < local_vertices.size(); i++) {
+            if(std::binary_search(border_positions.begin(), border_positions.end(), position_remap[local_vertices[i]])) {
+                positions.push_back(positions[i]);
+            }
+        }
+
+        const auto target_index_count = indices.size() / 6 * 3;
+
+        std::vector<uint32_t> simplified(indices.size());
+        auto error = 0.0f;
+        simplified.resize(meshopt_simplify(simplified.data(), local_indices.data(), local_indices.size(), &positions[0].x, positions.size(), sizeof(glm::vec3),
+                                           target_index_count, _LOD_MAX_ERROR, &error));
+
+        result.simplified = !simplified.empty() && static_cast<float>(simplified.size()) <= static_cast<float>(indices.size()) * _LOD_MIN_REDUCTION;
+        if(!result.simplified) {
+            return;
+        }
+
+        result.error = std::max(result.error, error * scale);
+
+        for(auto& index : simplified) {
+            index = local_vertices[index];
+        }
+
+        build_meshlets(parameters, simplified.data(), simplified.size(), vertices, result.build);
+    }
+
+    void build_cluster_lod(const mesh::meshlet_parameters& parameters, const std::vector<mesh::vertex>& vertices, std::span<const uint32_t> position_remap,
+                           std::span<const uint8_t> locked_positions, std::span<const mesh::meshlet> meshlets, const std::vector<uint32_t>& meshlet_data, meshlet_build& build,
+                           std::vector<mesh::lod_cluster>& clusters) noexcept {
+        std::vector<lod_work_cluster> level;
+
+        for(const auto& meshlet : meshlets) {
+            if(meshlet.triangle_count == 0) {
+                continue;
+            }
+
+            const auto* meshlet_vertices = meshlet_data.data() + meshlet.data_offset;
+            const auto* meshlet_triangles = reinterpret_cast<const uint8_t*>(meshlet_vertices + meshlet.vertex_count);
+
+            auto& cluster = level.emplace_back();
+            cluster.indices.resize(meshlet.triangle_count * 3);
+            for(uint32_t i = 0; i < meshlet.triangle_count * 3; i++) {
+                cluster.indices[i] = meshlet_vertices[meshlet_triangles[i]];
+            }
+
+            set_positions(cluster, position_remap);
+            set_sphere(cluster, vertices);
+            cluster.error = 0.0f;
+            cluster.index = static_cast<uint32_t>(clusters.size());
+
+            append_meshlet(meshlet_vertices, meshlet_triangles, meshlet.vertex_count, meshlet.triangle_count, build);
+            clusters.push_back(root_cluster(cluster, 0));
+        }
+
+        for(uint32_t depth = 1; level.size() > 1; depth++) {
+            std::vector<position_count> counts;
+            for(const auto& cluster : level) {
+                for(const auto position : cluster.positions) {
+                    counts.emplace_back(position, 1);
+                }
+            }
+
+            std::sort(counts.begin(), counts.end());
+
+            size_t unique_count = 0;
+            for(size_t i = 0; i < counts.size(); i++) {
+                if(unique_count > 0 && counts[unique_count - 1].first == counts[i].first) {
+                    counts[unique_count - 1].second++;
+                } else {
+                    counts[unique_count++] = counts[i];
+                }
+            }
+
+            counts.resize(unique_count);
+
+            // positions the submesh shares with others count one cluster more, so they are never inside a group
+            for(auto& [position, count] : counts) {
+                count += locked_positions[position];
+            }
+
+            const auto groups = group_clusters(level, counts);
+
+            std::vector<lod_group_result> results(groups.size());
+            util::parallel_for(groups.size(), _LOD_GROUP_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+                for(auto i = begin; i < end; i++) {
+                    simplify_group(parameters, vertices, position_remap, level, groups[i], counts, results[i]);
+                }
+            });
+
+            std::vector<lod_work_cluster> next_level;
+            auto any_simplified = false;
+
+            for(size_t i = 0; i < groups.size(); i++) {
+                const auto& result = results[i];
+                if(!result.simplified) {
+                    for(const auto cluster : groups[i]) {
+                        next_level.push_back(std::move(level[cluster]));
+                    }
+
+                    continue;
+                }
+
+                any_simplified = true;
+
+                for(const auto cluster : groups[i]) {
+                    auto& lod_cluster = clusters[level[cluster].index];
+                    lod_cluster.parent_center = result.center;
+                    lod_cluster.parent_radius = result.radius;
+                    lod_cluster.parent_error = result.error;
+                }
+
+                for(const auto& meshlet : result.build.meshlets) {
+                    const auto* meshlet_vertices = result.build.vertices.data() + meshlet.vertex_offset;
+                    const auto* meshlet_triangles = result.build.triangles.data() + meshlet.triangle_offset;
+
+                    auto& cluster = next_level.emplace_back();
+                    cluster.indices.resize(meshlet.triangle_count * 3);
+                    for(uint32_t j = 0; j < meshlet.triangle_count * 3; j++) {
+                        cluster.indices[j] = meshlet_vertices[meshlet_triangles[j]];
+                    }
+
+                    set_positions(cluster, position_remap);
+                    cluster.center = result.center;
+                    cluster.radius = result.radius;
+                    cluster.error = result.error;
+                    cluster.index = static_cast<uint32_t>(clusters.size());
+
+                    append_meshlet(meshlet_vertices, meshlet_triangles, meshlet.vertex_count, meshlet.triangle_count, build);
+                    clusters.push_back(root_cluster(cluster, depth));
+                }
+            }
+
+            level = std::move(next_level);
+
+            if(!any_simplified) {
+                break;
+            }
+        }
+    }
+
+    // pixels an object space error at the closest point of the sphere covers
+    static inline float get_projected_error(const glm::vec3& camera_position, const glm::vec3& center, float radius, float error, float projection_scale) noexcept {
+        const auto distance = glm::length(center - camera_position) - radius;
+        if(distance <= 0.0f) {
+            return error > 0.0f ? std::numeric_limits<float>::max() : 0.0f;
+        }
+
+        return error / distance * projection_scale;
+    }
+
+    size_t select_lod_clusters(std::span<const mesh::lod_cluster> clusters, std::span<const mesh::meshlet> meshlets, const glm::vec3& camera_position,
+                               float projection_scale, float threshold, std::vector<uint32_t>& selected_clusters) noexcept {
+        size_t triangle_count = 0;
+
+        for(uint32_t i = 0; i < clusters.size(); i++) {
+            const auto& cluster = clusters[i];
+
+            // a root's FLT_MAX error projects to at least FLT_MAX as well
+            const auto parent_error = get_projected_error(camera_position, cluster.parent_center, cluster.parent_radius, cluster.parent_error, projection_scale);
+            if(parent_error > threshold && get_projected_error(camera_position, cluster.center, cluster.radius, cluster.error, projection_scale) <= threshold) {
+                selected_clusters.push_back(i);
+                triangle_count += meshlets[i].triangle_count;
+            }
+        }
+
+        return triangle_count;
+    }
+}
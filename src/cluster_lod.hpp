@@ -0,0 +1,28 @@
+#pragma once
+
+#include "meshlet_builder.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace d3d12_mesh_shaders {
+    // Builds the continuous LOD DAG of one submesh from its meshlets, which are level 0. Each level groups adjacent clusters
+    // of the last by the vertex positions they share, simplifies every group to half its triangles with meshopt_simplify
+    // while the positions it shares with other groups stay locked, and clusterizes the result again with build_meshlets;
+    // groups that don't simplify are carried to the next level as they are. This repeats until no group simplifies. The
+    // clusters of all levels are appended to build and clusters in order, level 0 first and unchanged. position_remap maps
+    // every vertex to one with the same position, and locked_positions is 1 at the positions of position_remap that must not
+    // move, the ones shared with other submeshes.
+    void build_cluster_lod(const mesh::meshlet_parameters& parameters, const std::vector<mesh::vertex>& vertices, std::span<const uint32_t> position_remap,
+                           std::span<const uint8_t> locked_positions, std::span<const mesh::meshlet> meshlets, const std::vector<uint32_t>& meshlet_data, meshlet_build& build,
+                           std::vector<mesh::lod_cluster>& clusters) noexcept;
+
+    // CPU reference of the cut selection: appends every cluster whose error projects to at most threshold pixels and whose
+    // parent error projects to more, for a camera at camera_position. projection_scale is the viewport height in pixels over
+    // 2 tan(fov_y / 2). Returns the triangle count of the cut.
+    size_t select_lod_clusters(std::span<const mesh::lod_cluster> clusters, std::span<const mesh::meshlet> meshlets, const glm::vec3& camera_position,
+                               float projection_scale, float threshold, std::vector<uint32_t>& selected_clusters) noexcept;
+}
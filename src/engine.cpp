@@ -9,6 +9,21 @@
 #include <iostream>
 
 namespace d3d12_mesh_shaders {
+    static const char* _MESH_PATH = "dragon.obj";
+
+    static void print_mesh_statistics(const char* quality, const mesh& mesh) noexcept {
+        const auto& statistics = mesh.get_statistics();
+        std::cout << _MESH_PATH << " (" << quality << "): built in " << statistics.total_seconds * 1000.0 << " ms, parsed "
+                  << statistics.source_bytes / (1024 * 1024) << " MB in " << statistics.parse_seconds * 1000.0 << " ms ("
+                  << statistics.get_parse_throughput() << " MB/s), welded " << mesh.get_vertices().size() << " vertices in "
+                  << statistics.weld_seconds * 1000.0 << " ms, removed " << statistics.degenerate_triangle_count << " degenerate and "
+                  << statistics.duplicate_triangle_count << " duplicate triangles, generated " << statistics.generated_normal_count << " normals in "
+                  << statistics.normal_seconds * 1000.0 << " ms, merged " << statistics.merged_meshlet_count << " meshlets for a fill of "
+                  << statistics.meshlet_fill_ratio * 100.0 << "%, optimized meshlets in "
+                  << statistics.meshlet_optimize_seconds * 1000.0 << " ms, " << statistics.scratch_allocation_count << " scratch allocations peaking at "
+                  << statistics.scratch_peak_bytes / 1024 << " KB" << std::endl;
+    }
+
     void engine::create_window() noexcept {
         if(SDL_Init(SDL_INIT_EVERYTHING) != 0) {
             util::panic("SDL_Init");
@@ -222,21 +237,51 @@ namespace d3d12_mesh_shaders {
     }
 
     void engine::init_mesh() noexcept {
-        mesh current_mesh("dragon.obj");
+        mesh::build_options preview_options;
+        preview_options.quality = mesh::build_quality::preview;
+
+        const mesh preview_mesh(_MESH_PATH, preview_options);
+        print_mesh_statistics("preview", preview_mesh);
+        upload_mesh(preview_mesh);
 
+        _full_mesh = std::async(std::launch::async, [this]() noexcept {
+            mesh::build_options full_options;
+            full_options.cancel = &_cancel_full_mesh;
+
+            return mesh(_MESH_PATH, full_options);
+        });
+    }
+
+    void engine::upload_mesh(const mesh& mesh) noexcept {
         _model_vertices_uav.ptr = _cbv_srv_uav_descriptor_heap_start_cpu.ptr + _cbv_srv_uav_descriptor_increment_size;
-        util::create_device_buffer_and_uav(_device, _direct_queue, _allocator, current_mesh.get_vertices().data(), current_mesh.get_vertices().size(), sizeof(mesh::vertex),
+        util::create_device_buffer_and_uav(_device, _direct_queue, _allocator, mesh.get_vertices().data(), mesh.get_vertices().size(), sizeof(mesh::vertex),
                                            _model_vertices_uav, _model_vertices_resource, _model_vertices_allocation);
 
         _model_meshlets_uav.ptr = _cbv_srv_uav_descriptor_heap_start_cpu.ptr + 2 * _cbv_srv_uav_descriptor_increment_size;
-        util::create_device_buffer_and_uav(_device, _direct_queue, _allocator, current_mesh.get_meshlets().data(), current_mesh.get_meshlets().size(), sizeof(mesh::meshlet),
+        util::create_device_buffer_and_uav(_device, _direct_queue, _allocator, mesh.get_meshlets().data(), mesh.get_meshlets().size(), sizeof(mesh::meshlet),
                                            _model_meshlets_uav, _model_meshlets_resource, _model_meshlets_allocation);
 
         _model_meshlet_data_uav.ptr = _cbv_srv_uav_descriptor_heap_start_cpu.ptr + 3 * _cbv_srv_uav_descriptor_increment_size;
-        util::create_device_buffer_and_uav(_device, _direct_queue, _allocator, current_mesh.get_meshlet_data().data(), current_mesh.get_meshlet_data().size(), sizeof(uint32_t),
+        util::create_device_buffer_and_uav(_device, _direct_queue, _allocator, mesh.get_meshlet_data().data(), mesh.get_meshlet_data().size(), sizeof(uint32_t),
                                            _model_meshlet_data_uav, _model_meshlet_data_resource, _model_meshlet_data_allocation);
 
-        _model_num_meshlets = static_cast<uint32_t>(current_mesh.get_meshlets().size());
+        _model_num_meshlets = static_cast<uint32_t>(mesh.get_meshlets().size());
+    }
+
+    void engine::swap_in_full_mesh() noexcept {
+        if(!_full_mesh.valid() || _full_mesh.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return;
+        }
+
+        const auto full_mesh = _full_mesh.get();
+        print_mesh_statistics("full", full_mesh);
+
+        // run_frame waits for the GPU at the end of every frame, so nothing reads the preview buffers anymore
+        destroy_mesh();
+        upload_mesh(full_mesh);
+
+        std::cout << _MESH_PATH << ": full quality swapped in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start_time).count()
+                  << " ms after startup" << std::endl;
     }
 
     void engine::destroy_mesh() noexcept {
@@ -412,6 +457,9 @@ namespace d3d12_mesh_shaders {
 
     engine::engine(bool debug_mode, uint32_t width, uint32_t height) noexcept
         : _camera(glm::vec3(0.0f), glm::vec3(0.0f)) {
+        _start_time = std::chrono::steady_clock::now();
+        _first_frame_presented = false;
+
         _debug_mode = debug_mode;
         _width = width;
         _height = height;
@@ -427,6 +475,12 @@ namespace d3d12_mesh_shaders {
     }
 
     engine::~engine() noexcept {
+        // a full build still running stops at its next pass instead of holding up the exit
+        _cancel_full_mesh.store(true, std::memory_order_relaxed);
+        if(_full_mesh.valid()) {
+            _full_mesh.wait();
+        }
+
         if(_fence->GetCompletedValue() < 1) {
             _fence->SetEventOnCompletion(1, _fence_event);
             WaitForSingleObject(_fence_event, INFINITE);
@@ -461,7 +515,14 @@ namespace d3d12_mesh_shaders {
                 }
             }
 
+            swap_in_full_mesh();
             run_frame();
+
+            if(!_first_frame_presented) {
+                std::cout << _MESH_PATH << ": first frame presented " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start_time).count()
+                          << " ms after startup" << std::endl;
+                _first_frame_presented = true;
+            }
         }
     }
 }
\ No newline at end of file
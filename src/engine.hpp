@@ -1,6 +1,7 @@
 #pragma once
 
 #include "camera.hpp"
+#include "mesh.hpp"
 
 #include <SDL2/SDL.h>
 
@@ -9,6 +10,9 @@
 #include <D3D12MemAlloc/D3D12MemAlloc.h>
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <future>
 
 namespace d3d12_mesh_shaders {
     class engine final {
@@ -72,6 +76,14 @@ namespace d3d12_mesh_shaders {
 
         uint32_t _model_num_meshlets;
 
+        // init_mesh uploads a preview build and starts the full quality build here; swap_in_full_mesh replaces the preview
+        // once it is done, and the destructor cancels it if it isn't
+        std::future<mesh> _full_mesh;
+        std::atomic<bool> _cancel_full_mesh = false;
+
+        std::chrono::steady_clock::time_point _start_time;
+        bool _first_frame_presented;
+
         camera _camera;
 
         bool _debug_mode;
@@ -90,6 +102,8 @@ namespace d3d12_mesh_shaders {
         void destroy_constant_buffer() noexcept;
 
         void init_mesh() noexcept;
+        void upload_mesh(const mesh& mesh) noexcept;
+        void swap_in_full_mesh() noexcept;
         void destroy_mesh() noexcept;
 
         void init_mesh_shader() noexcept;
@@ -0,0 +1,650 @@
+#include "glb_parser.hpp"
+#include "mapped_file.hpp"
+#include "util.hpp"
+
+#include <meshoptimizer/meshoptimizer.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <charconv>
+#include <cstring>
+#include <string>
+
+namespace d3d12_mesh_shaders {
+    static const uint32_t _GLB_MAGIC = 0x46546c67;
+    static const uint32_t _GLB_CHUNK_JSON = 0x4e4f534a;
+    static const uint32_t _GLB_CHUNK_BIN = 0x004e4942;
+
+    static const uint32_t _COMPONENT_BYTE = 5120;
+    static const uint32_t _COMPONENT_UNSIGNED_BYTE = 5121;
+    static const uint32_t _COMPONENT_SHORT = 5122;
+    static const uint32_t _COMPONENT_UNSIGNED_SHORT = 5123;
+    static const uint32_t _COMPONENT_UNSIGNED_INT = 5125;
+    static const uint32_t _COMPONENT_FLOAT = 5126;
+
+    static const uint32_t _MODE_TRIANGLES = 4;
+
+    static const size_t _VERTEX_BATCH_SIZE = 1 << 16;
+
+    // Just enough JSON for a glTF document. Object members keep their keys in `keys` and their values in `values`.
+    struct json_value final {
+        enum class value_type {
+            null,
+            boolean,
+            number,
+            string,
+            array,
+            object
+        };
+
+        value_type type = value_type::null;
+        bool boolean = false;
+        double number = 0.0;
+        std::string string;
+        std::vector<std::string> keys;
+        std::vector<json_value> values;
+
+        [[nodiscard]] const json_value* find(const std::string_view& key) const noexcept {
+            for(size_t i = 0; i < keys.size(); i++) {
+                if(keys[i] == key) {
+                    return &values[i];
+                }
+            }
+
+            return nullptr;
+        }
+
+        [[nodiscard]] double get_number(const std::string_view& key, double fallback) const noexcept {
+            const auto* value = find(key);
+            return value && value->type == value_type::number ? value->number : fallback;
+        }
+
+        [[nodiscard]] std::string_view get_string(const std::string_view& key) const noexcept {
+            const auto* value = find(key);
+            return value && value->type == value_type::string ? std::string_view(value->string) : std::string_view();
+        }
+
+        [[nodiscard]] const std::vector<json_value>& get_array(const std::string_view& key) const noexcept {
+            static const std::vector<json_value> empty;
+
+            const auto* value = find(key);
+            return value && value->type == value_type::array ? value->values : empty;
+        }
+    };
+
+    class json_reader final {
+    private:
+        const char* _ptr;
+        const char* _end;
+
+        void skip_whitespace() noexcept {
+            while(_ptr < _end && (*_ptr == ' ' || *_ptr == '\t' || *_ptr == '\r' || *_ptr == '\n')) {
+                _ptr++;
+            }
+        }
+
+        void expect(char c) noexcept {
+            skip_whitespace();
+            if(_ptr >= _end || *_ptr != c) {
+                util::panic("glb_parser: malformed json");
+            }
+            _ptr++;
+        }
+
+        bool consume(char c) noexcept {
+            skip_whitespace();
+            if(_ptr < _end && *_ptr == c) {
+                _ptr++;
+                return true;
+            }
+            return false;
+        }
+
+        bool consume_literal(const std::string_view& literal) noexcept {
+            if(static_cast<size_t>(_end - _ptr) >= literal.size() && std::string_view(_ptr, literal.size()) == literal) {
+                _ptr += literal.size();
+                return true;
+            }
+            return false;
+        }
+
+        void append_utf8(std::string& string, uint32_t code_point) noexcept {
+            if(code_point < 0x80) {
+                string.push_back(static_cast<char>(code_point));
+            } else if(code_point < 0x800) {
+                string.push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+                string.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+            } else {
+                string.push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+                string.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+                string.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+            }
+        }
+
+        void read_string(std::string& string) noexcept {
+            expect('"');
+
+            while(_ptr < _end && *_ptr != '"') {
+                if(*_ptr != '\\') {
+                    string.push_back(*_ptr++);
+                    continue;
+                }
+
+                if(++_ptr >= _end) {
+                    break;
+                }
+
+                switch(*_ptr++) {
+                    case 'b': string.push_back('\b'); break;
+                    case 'f': string.push_back('\f'); break;
+                    case 'n': string.push_back('\n'); break;
+                    case 'r': string.push_back('\r'); break;
+                    case 't': string.push_back('\t'); break;
+                    case 'u': {
+                        uint32_t code_point = 0;
+                        if(_end - _ptr < 4 || std::from_chars(_ptr, _ptr + 4, code_point, 16).ptr != _ptr + 4) {
+                            util::panic("glb_parser: malformed json");
+                        }
+                        _ptr += 4;
+                        append_utf8(string, code_point);
+                        break;
+                    }
+                    default: string.push_back(_ptr[-1]); break;
+                }
+            }
+
+            expect('"');
+        }
+
+    public:
+        json_reader(const char* data, size_t size) noexcept : _ptr(data), _end(data + size) {}
+
+        void read_value(json_value& value) noexcept {
+            skip_whitespace();
+            if(_ptr >= _end) {
+                util::panic("glb_parser: malformed json");
+            }
+
+            if(*_ptr == '{') {
+                value.type = json_value::value_type::object;
+                _ptr++;
+
+                if(consume('}')) {
+                    return;
+                }
+
+                do {
+                    skip_whitespace();
+                    read_string(value.keys.emplace_back());
+                    expect(':');
+                    read_value(value.values.emplace_back());
+                } while(consume(','));
+
+                expect('}');
+            } else if(*_ptr == '[') {
+                value.type = json_value::value_type::array;
+                _ptr++;
+
+                if(consume(']')) {
+                    return;
+                }
+
+                do {
+                    read_value(value.values.emplace_back());
+                } while(consume(','));
+
+                expect(']');
+            } else if(*_ptr == '"') {
+                value.type = json_value::value_type::string;
+                read_string(value.string);
+            } else if(consume_literal("true")) {
+                value.type = json_value::value_type::boolean;
+                value.boolean = true;
+            } else if(consume_literal("false")) {
+                value.type = json_value::value_type::boolean;
+            } else if(consume_literal("null")) {
+                value.type = json_value::value_type::null;
+            } else {
+                value.type = json_value::value_type::number;
+
+                const auto result = std::from_chars(_ptr, _end, value.number);
+                if(result.ec != std::errc()) {
+                    util::panic("glb_parser: malformed json");
+                }
+                _ptr = result.ptr;
+            }
+        }
+    };
+
+    struct accessor final {
+        const uint8_t* data;
+        size_t count;
+        size_t stride;
+        uint32_t component_type;
+        size_t num_components;
+        bool normalized;
+    };
+
+    static size_t get_component_size(uint32_t component_type) noexcept {
+        switch(component_type) {
+            case _COMPONENT_BYTE:
+            case _COMPONENT_UNSIGNED_BYTE:
+                return 1;
+            case _COMPONENT_SHORT:
+            case _COMPONENT_UNSIGNED_SHORT:
+                return 2;
+            case _COMPONENT_UNSIGNED_INT:
+            case _COMPONENT_FLOAT:
+                return 4;
+        }
+
+        util::panic("glb_parser: unknown component type");
+        return 0;
+    }
+
+    static size_t get_num_components(const std::string_view& type) noexcept {
+        if(type == "SCALAR") return 1;
+        if(type == "VEC2") return 2;
+        if(type == "VEC3") return 3;
+        if(type == "VEC4") return 4;
+
+        util::panic("glb_parser: unsupported accessor type");
+        return 0;
+    }
+
+    template<typename T>
+    static inline T read_unaligned(const uint8_t* data) noexcept {
+        T value;
+        memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    static inline float read_component(const uint8_t* data, uint32_t component_type, bool normalized) noexcept {
+        switch(component_type) {
+            case _COMPONENT_BYTE: {
+                const auto value = static_cast<float>(read_unaligned<int8_t>(data));
+                return normalized ? std::max(value / 127.0f, -1.0f) : value;
+            }
+            case _COMPONENT_UNSIGNED_BYTE: {
+                const auto value = static_cast<float>(read_unaligned<uint8_t>(data));
+                return normalized ? value / 255.0f : value;
+            }
+            case _COMPONENT_SHORT: {
+                const auto value = static_cast<float>(read_unaligned<int16_t>(data));
+                return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+            }
+            case _COMPONENT_UNSIGNED_SHORT: {
+                const auto value = static_cast<float>(read_unaligned<uint16_t>(data));
+                return normalized ? value / 65535.0f : value;
+            }
+            case _COMPONENT_UNSIGNED_INT:
+                return static_cast<float>(read_unaligned<uint32_t>(data));
+            case _COMPONENT_FLOAT:
+                return read_unaligned<float>(data);
+        }
+
+        return 0.0f;
+    }
+
+    static inline uint32_t read_index(const uint8_t* data, uint32_t component_type) noexcept {
+        switch(component_type) {
+            case _COMPONENT_UNSIGNED_BYTE: return read_unaligned<uint8_t>(data);
+            case _COMPONENT_UNSIGNED_SHORT: return read_unaligned<uint16_t>(data);
+            case _COMPONENT_UNSIGNED_INT: return read_unaligned<uint32_t>(data);
+        }
+
+        util::panic("glb_parser: invalid index component type");
+        return 0;
+    }
+
+    static glm::vec4 read_element(const accessor& accessor, size_t index) noexcept {
+        const auto* data = accessor.data + index * accessor.stride;
+        const auto component_size = get_component_size(accessor.component_type);
+
+        glm::vec4 result(0.0f);
+        for(size_t i = 0; i < accessor.num_components; i++) {
+            result[static_cast<glm::length_t>(i)] = read_component(data + i * component_size, accessor.component_type, accessor.normalized);
+        }
+
+        return result;
+    }
+
+    static glm::mat4 get_node_matrix(const json_value& node) noexcept {
+        const auto& matrix = node.get_array("matrix");
+        if(matrix.size() == 16) {
+            glm::mat4 result;
+            for(glm::length_t i = 0; i < 16; i++) {
+                result[i / 4][i % 4] = static_cast<float>(matrix[i].number);
+            }
+            return result;
+        }
+
+        const auto read_vector = [&](const std::string_view& key, const glm::vec4& fallback) noexcept {
+            const auto& values = node.get_array(key);
+
+            auto result = fallback;
+            for(glm::length_t i = 0; i < static_cast<glm::length_t>(std::min<size_t>(values.size(), 4)); i++) {
+                result[i] = static_cast<float>(values[i].number);
+            }
+            return result;
+        };
+
+        const auto translation = read_vector("translation", glm::vec4(0.0f));
+        const auto rotation = read_vector("rotation", glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        const auto scale = read_vector("scale", glm::vec4(1.0f));
+
+        const glm::mat4 translation_matrix = glm::translate(glm::mat4(1.0f), glm::vec3(translation));
+        const glm::mat4 rotation_matrix = glm::mat4_cast(glm::quat(rotation.w, rotation.x, rotation.y, rotation.z));
+        const glm::mat4 scale_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(scale));
+
+        return translation_matrix * rotation_matrix * scale_matrix;
+    }
+
+    glb_parser::glb_parser(const std::string_view& path) noexcept {
+        const mapped_file file(path);
+        if(!file.is_open()) {
+            util::panic("mapped_file");
+        }
+
+        _source_bytes = file.get_size();
+
+        const auto* data = reinterpret_cast<const uint8_t*>(file.get_data());
+        const auto size = file.get_size();
+
+        if(size < 20 || read_unaligned<uint32_t>(data) != _GLB_MAGIC || read_unaligned<uint32_t>(data + 4) != 2) {
+            util::panic("glb_parser: not a glTF 2.0 binary");
+        }
+
+        const char* json_data = nullptr;
+        size_t json_size = 0;
+
+        const uint8_t* bin_data = nullptr;
+        size_t bin_size = 0;
+
+        for(size_t offset = 12; offset + 8 <= size;) {
+            const auto chunk_size = read_unaligned<uint32_t>(data + offset);
+            const auto chunk_type = read_unaligned<uint32_t>(data + offset + 4);
+
+            if(offset + 8 + chunk_size > size) {
+                util::panic("glb_parser: truncated chunk");
+            }
+
+            if(chunk_type == _GLB_CHUNK_JSON && !json_data) {
+                json_data = reinterpret_cast<const char*>(data + offset + 8);
+                json_size = chunk_size;
+            } else if(chunk_type == _GLB_CHUNK_BIN && !bin_data) {
+                bin_data = data + offset + 8;
+                bin_size = chunk_size;
+            }
+
+            offset += 8 + ((chunk_size + 3) & ~3u);
+        }
+
+        if(!json_data) {
+            util::panic("glb_parser: missing JSON chunk");
+        }
+
+        json_value document;
+        json_reader(json_data, json_size).read_value(document);
+
+        // Only the GLB BIN chunk can carry data. The meshopt fallback buffer has no contents and must only be reached
+        // through compressed views.
+        const auto get_buffer_data = [&](size_t buffer_index, size_t offset, size_t length) noexcept {
+            const auto& buffers = document.get_array("buffers");
+            if(buffer_index != 0 || buffer_index >= buffers.size() || buffers[0].find("uri") || offset + length > bin_size) {
+                util::panic("glb_parser: buffer view does not point into the BIN chunk");
+            }
+
+            return bin_data + offset;
+        };
+
+        const auto& buffer_views = document.get_array("bufferViews");
+
+        std::vector<const uint8_t*> view_data(buffer_views.size(), nullptr);
+        std::vector<size_t> view_sizes(buffer_views.size(), 0);
+        std::vector<std::vector<uint8_t>> decoded_views(buffer_views.size());
+
+        util::parallel_for(buffer_views.size(), 1, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                const auto& view = buffer_views[i];
+
+                const auto* extensions = view.find("extensions");
+                const auto* compression = extensions ? extensions->find("EXT_meshopt_compression") : nullptr;
+
+                if(!compression) {
+                    const auto buffer_index = static_cast<size_t>(view.get_number("buffer", 0.0));
+                    const auto offset = static_cast<size_t>(view.get_number("byteOffset", 0.0));
+                    const auto length = static_cast<size_t>(view.get_number("byteLength", 0.0));
+
+                    const auto& buffers = document.get_array("buffers");
+                    const auto* buffer_extensions = buffer_index < buffers.size() ? buffers[buffer_index].find("extensions") : nullptr;
+
+                    // views into the fallback buffer only exist for readers without meshopt support
+                    if(!buffer_extensions || !buffer_extensions->find("EXT_meshopt_compression")) {
+                        view_data[i] = get_buffer_data(buffer_index, offset, length);
+                        view_sizes[i] = length;
+                    }
+                    continue;
+                }
+
+                const auto buffer_index = static_cast<size_t>(compression->get_number("buffer", 0.0));
+                const auto offset = static_cast<size_t>(compression->get_number("byteOffset", 0.0));
+                const auto length = static_cast<size_t>(compression->get_number("byteLength", 0.0));
+                const auto stride = static_cast<size_t>(compression->get_number("byteStride", 0.0));
+                const auto count = static_cast<size_t>(compression->get_number("count", 0.0));
+                const auto mode = compression->get_string("mode");
+                const auto filter = compression->get_string("filter");
+
+                const auto* source = get_buffer_data(buffer_index, offset, length);
+
+                auto& decoded = decoded_views[i];
+                decoded.resize(count * stride);
+
+                int result = -1;
+                if(mode == "ATTRIBUTES") {
+                    result = meshopt_decodeVertexBuffer(decoded.data(), count, stride, source, length);
+                } else if(mode == "TRIANGLES") {
+                    result = meshopt_decodeIndexBuffer(decoded.data(), count, stride, source, length);
+                } else if(mode == "INDICES") {
+                    result = meshopt_decodeIndexSequence(decoded.data(), count, stride, source, length);
+                }
+
+                if(result != 0) {
+                    util::panic("glb_parser: EXT_meshopt_compression decode");
+                }
+
+                if(filter == "OCTAHEDRAL") {
+                    meshopt_decodeFilterOct(decoded.data(), count, stride);
+                } else if(filter == "QUATERNION") {
+                    meshopt_decodeFilterQuat(decoded.data(), count, stride);
+                } else if(filter == "EXPONENTIAL") {
+                    meshopt_decodeFilterExp(decoded.data(), count, stride);
+                }
+
+                view_data[i] = decoded.data();
+                view_sizes[i] = decoded.size();
+            }
+        });
+
+        const auto& accessors = document.get_array("accessors");
+
+        const auto get_accessor = [&](size_t index) noexcept {
+            if(index >= accessors.size()) {
+                util::panic("glb_parser: accessor out of range");
+            }
+
+            const auto& json_accessor = accessors[index];
+            if(json_accessor.find("sparse")) {
+                util::panic("glb_parser: sparse accessors are not supported");
+            }
+
+            const auto view_index = static_cast<size_t>(json_accessor.get_number("bufferView", -1.0));
+            if(view_index >= buffer_views.size() || !view_data[view_index]) {
+                util::panic("glb_parser: accessor without data");
+            }
+
+            const auto offset = static_cast<size_t>(json_accessor.get_number("byteOffset", 0.0));
+            const auto component_type = static_cast<uint32_t>(json_accessor.get_number("componentType", 0.0));
+            const auto num_components = get_num_components(json_accessor.get_string("type"));
+            const auto element_size = get_component_size(component_type) * num_components;
+            const auto* normalized = json_accessor.find("normalized");
+
+            const accessor result = {
+                .data = view_data[view_index] + offset,
+                .count = static_cast<size_t>(json_accessor.get_number("count", 0.0)),
+                .stride = static_cast<size_t>(buffer_views[view_index].get_number("byteStride", static_cast<double>(element_size))),
+                .component_type = component_type,
+                .num_components = num_components,
+                .normalized = normalized && normalized->boolean
+            };
+
+            // the last element has to end inside the view, written so that huge counts can't wrap around
+            const auto view_size = view_sizes[view_index];
+            if(offset > view_size || element_size > view_size - offset
+               || (result.count > 0 && result.stride > 0 && result.count - 1 > (view_size - offset - element_size) / result.stride)) {
+                util::panic("glb_parser: accessor exceeds its buffer view");
+            }
+
+            return result;
+        };
+
+        const auto& meshes = document.get_array("meshes");
+
+        // primitives without a material share the default material, one slot past the materials of the file
+        const auto default_material = static_cast<uint32_t>(document.get_array("materials").size());
+
+        const auto append_mesh = [&](size_t mesh_index, const glm::mat4& transform) noexcept {
+            if(mesh_index >= meshes.size()) {
+                util::panic("glb_parser: mesh out of range");
+            }
+
+            const auto normal_transform = glm::transpose(glm::inverse(glm::mat3(transform)));
+
+            // a mirroring transform turns the triangles inside out, so glTF asks for their winding to be reversed
+            const auto flip_winding = glm::determinant(glm::mat3(transform)) < 0.0f;
+            const size_t corner_1 = flip_winding ? 2 : 1;
+            const size_t corner_2 = flip_winding ? 1 : 2;
+
+            for(const auto& primitive : meshes[mesh_index].get_array("primitives")) {
+                if(static_cast<uint32_t>(primitive.get_number("mode", _MODE_TRIANGLES)) != _MODE_TRIANGLES) {
+                    continue;
+                }
+
+                const auto* attributes = primitive.find("attributes");
+                const auto* position_index = attributes ? attributes->find("POSITION") : nullptr;
+                if(!position_index) {
+                    continue;
+                }
+
+                const auto* normal_index = attributes->find("NORMAL");
+                const auto* tex_coord_index = attributes->find("TEXCOORD_0");
+
+                const auto positions = get_accessor(static_cast<size_t>(position_index->number));
+                const auto normals = normal_index ? get_accessor(static_cast<size_t>(normal_index->number)) : accessor {};
+                const auto tex_coords = tex_coord_index ? get_accessor(static_cast<size_t>(tex_coord_index->number)) : accessor {};
+
+                const auto base_vertex = _vertices.size();
+                _vertices.resize(base_vertex + positions.count);
+
+                util::parallel_for(positions.count, _VERTEX_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+                    for(auto i = begin; i < end; i++) {
+                        const auto position = glm::vec3(transform * glm::vec4(glm::vec3(read_element(positions, i)), 1.0f));
+
+                        auto normal = glm::vec3(0.0f);
+                        if(normal_index && i < normals.count) {
+                            normal = normal_transform * glm::vec3(read_element(normals, i));
+
+                            const auto length = glm::length(normal);
+                            normal = length > 0.0f ? normal / length : normal;
+                        }
+
+                        const auto tex_coord = tex_coord_index && i < tex_coords.count ? glm::vec2(read_element(tex_coords, i)) : glm::vec2(0.0f);
+
+                        _vertices[base_vertex + i] = mesh::vertex(position, tex_coord, normal);
+                    }
+                });
+
+                const auto material = static_cast<uint32_t>(primitive.get_number("material", static_cast<double>(default_material)));
+
+                const auto* indices_index = primitive.find("indices");
+                if(!indices_index) {
+                    for(size_t i = 0; i + 2 < positions.count; i += 3) {
+                        _indices.push_back(static_cast<uint32_t>(base_vertex + i));
+                        _indices.push_back(static_cast<uint32_t>(base_vertex + i + corner_1));
+                        _indices.push_back(static_cast<uint32_t>(base_vertex + i + corner_2));
+                    }
+
+                    _triangle_materials.resize(_indices.size() / 3, material);
+                    continue;
+                }
+
+                const auto indices = get_accessor(static_cast<size_t>(indices_index->number));
+                const auto base_index = _indices.size();
+                _indices.resize(base_index + indices.count / 3 * 3);
+
+                for(size_t i = 0; i < indices.count / 3 * 3; i++) {
+                    const auto index = read_index(indices.data + i * indices.stride, indices.component_type);
+                    if(index >= positions.count) {
+                        util::panic("glb_parser: vertex index out of range");
+                    }
+
+                    _indices[base_index + i] = static_cast<uint32_t>(base_vertex + index);
+                }
+
+                if(flip_winding) {
+                    for(auto i = base_index; i < _indices.size(); i += 3) {
+                        std::swap(_indices[i + 1], _indices[i + 2]);
+                    }
+                }
+
+                _triangle_materials.resize(_indices.size() / 3, material);
+            }
+        };
+
+        const auto& nodes = document.get_array("nodes");
+        const auto& scenes = document.get_array("scenes");
+
+        if(scenes.empty()) {
+            for(size_t i = 0; i < meshes.size(); i++) {
+                append_mesh(i, glm::mat4(1.0f));
+            }
+            return;
+        }
+
+        const auto scene_index = std::min(static_cast<size_t>(document.get_number("scene", 0.0)), scenes.size() - 1);
+
+        // glTF nodes form a forest, so a node reached twice means a cycle that would never stop expanding
+        std::vector<uint8_t> visited(nodes.size());
+
+        std::vector<std::pair<size_t, glm::mat4>> stack;
+        for(const auto& root : scenes[scene_index].get_array("nodes")) {
+            stack.emplace_back(static_cast<size_t>(root.number), glm::mat4(1.0f));
+        }
+
+        while(!stack.empty()) {
+            const auto [node_index, parent_transform] = stack.back();
+            stack.pop_back();
+
+            if(node_index >= nodes.size()) {
+                util::panic("glb_parser: node out of range");
+            }
+
+            if(visited[node_index]) {
+                util::panic("glb_parser: node hierarchy is not a tree");
+            }
+            visited[node_index] = 1;
+
+            const auto& node = nodes[node_index];
+            const auto transform = parent_transform * get_node_matrix(node);
+
+            if(const auto* mesh_index = node.find("mesh")) {
+                append_mesh(static_cast<size_t>(mesh_index->number), transform);
+            }
+
+            for(const auto& child : node.get_array("children")) {
+                stack.emplace_back(static_cast<size_t>(child.number), transform);
+            }
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace d3d12_mesh_shaders {
+    // Reader for binary glTF 2.0 (.glb). Buffer views compressed with EXT_meshopt_compression are decoded in parallel,
+    // filters included, before the triangle primitives of every mesh instance in the default scene are flattened into one
+    // vertex and index buffer with their node transforms applied. KHR_mesh_quantization attributes are dequantized. Triangles
+    // without a material get the slot one past the materials of the file.
+    class glb_parser final {
+    private:
+        std::vector<mesh::vertex> _vertices;
+        std::vector<uint32_t> _indices;
+        std::vector<uint32_t> _triangle_materials;
+
+        size_t _source_bytes;
+
+    public:
+        glb_parser(const std::string_view& path) noexcept;
+
+        [[nodiscard]] inline std::vector<mesh::vertex>& get_vertices() noexcept {
+            return _vertices;
+        }
+
+        [[nodiscard]] inline std::vector<uint32_t>& get_indices() noexcept {
+            return _indices;
+        }
+
+        [[nodiscard]] inline const std::vector<uint32_t>& get_triangle_materials() const noexcept {
+            return _triangle_materials;
+        }
+
+        [[nodiscard]] inline size_t get_source_bytes() const noexcept {
+            return _source_bytes;
+        }
+    };
+}
@@ -0,0 +1,433 @@
+#include "graph_clusterizer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace d3d12_mesh_shaders {
+    // parts estimated at this many meshlets or fewer are cut into meshlets directly instead of being bisected further
+    static const size_t _FILL_PART_MESHLETS = 8;
+    static const size_t _SMOOTHING_PASSES = 2;
+
+    // how far, in radii of the meshlet so far, a disconnected piece may be to still be added to it
+    static const float _JOIN_DISTANCE = 2.0f;
+
+    class graph_partitioner final {
+    private:
+        const uint32_t* _indices;
+        uint32_t _max_vertices;
+        uint32_t _max_triangles;
+
+        // per triangle: centroid, and the distance from it to the furthest corner
+        std::vector<glm::vec3> _centroids;
+        std::vector<float> _radii;
+
+        // triangle -> edge adjacent triangles, as offsets into one flat array
+        std::vector<uint32_t> _adjacency_offsets;
+        std::vector<uint32_t> _adjacency;
+
+        // every range being split gets a fresh pair of stamps, so membership never has to be cleared
+        std::vector<uint32_t> _triangle_stamps;
+        uint32_t _triangle_stamp = 0;
+
+        std::vector<uint32_t> _vertex_stamps;
+        std::vector<uint32_t> _local_vertices;
+        uint32_t _vertex_stamp = 0;
+
+        std::vector<uint32_t> _triangles;
+        std::vector<uint32_t> _meshlet_triangles;
+
+        // (priority, triangle), the frontier is a min heap
+        std::vector<std::pair<float, uint32_t>> _seeds;
+        std::vector<std::pair<float, uint32_t>> _frontier;
+
+        meshlet_build& _build;
+
+        [[nodiscard]] uint32_t count_vertices(size_t begin, size_t end) noexcept {
+            _vertex_stamp++;
+
+            uint32_t count = 0;
+            for(auto i = begin; i < end; i++) {
+                for(size_t j = 0; j < 3; j++) {
+                    const auto index = _indices[_triangles[i] * 3 + j];
+                    if(_vertex_stamps[index] != _vertex_stamp) {
+                        _vertex_stamps[index] = _vertex_stamp;
+                        count++;
+                    }
+                }
+            }
+
+            return count;
+        }
+
+        // corners of the triangle not yet in the meshlet being grown
+        [[nodiscard]] inline uint32_t count_new_vertices(uint32_t triangle) const noexcept {
+            uint32_t count = 0;
+            for(size_t j = 0; j < 3; j++) {
+                count += _vertex_stamps[_indices[triangle * 3 + j]] != _vertex_stamp;
+            }
+
+            return count;
+        }
+
+        void emit_meshlet(const std::vector<uint32_t>& triangles) noexcept {
+            _vertex_stamp++;
+
+            meshopt_Meshlet meshlet {
+                .vertex_offset = static_cast<unsigned int>(_build.vertices.size()),
+                .triangle_offset = static_cast<unsigned int>(_build.triangles.size()),
+                .vertex_count = 0,
+                .triangle_count = static_cast<unsigned int>(triangles.size())
+            };
+
+            for(const auto triangle : triangles) {
+                for(size_t j = 0; j < 3; j++) {
+                    const auto index = _indices[triangle * 3 + j];
+                    if(_vertex_stamps[index] != _vertex_stamp) {
+                        _vertex_stamps[index] = _vertex_stamp;
+                        _local_vertices[index] = meshlet.vertex_count++;
+                        _build.vertices.push_back(index);
+                    }
+
+                    _build.triangles.push_back(static_cast<uint8_t>(_local_vertices[index]));
+                }
+            }
+
+            _build.triangles.resize((_build.triangles.size() + 3) & ~size_t(3));
+            _build.meshlets.push_back(meshlet);
+        }
+
+        // Stamps [begin, end) as members of a fresh part and fills _seeds with its triangles in order along the longest axis
+        // of their centroids, which is returned.
+        [[nodiscard]] int prepare_part(size_t begin, size_t end, uint32_t member) noexcept {
+            auto min = glm::vec3(std::numeric_limits<float>::max()), max = glm::vec3(-std::numeric_limits<float>::max());
+            for(auto i = begin; i < end; i++) {
+                _triangle_stamps[_triangles[i]] = member;
+                min = glm::min(min, _centroids[_triangles[i]]);
+                max = glm::max(max, _centroids[_triangles[i]]);
+            }
+
+            const auto extent = max - min;
+            const auto axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+            _seeds.clear();
+            for(auto i = begin; i < end; i++) {
+                _seeds.emplace_back(_centroids[_triangles[i]][axis], _triangles[i]);
+            }
+
+            std::sort(_seeds.begin(), _seeds.end());
+            return axis;
+        }
+
+        // Reorders [begin, end) so that it starts with a grown region of about target triangles, both halves keeping their
+        // order, and returns the size of the region.
+        [[nodiscard]] size_t bisect(size_t begin, size_t end, size_t target) noexcept {
+            const auto member = ++_triangle_stamp;
+            const auto grown = ++_triangle_stamp;
+
+            const auto axis = prepare_part(begin, end, member);
+
+            _frontier.clear();
+
+            size_t grown_count = 0, next_seed = 0;
+            while(grown_count < target) {
+                // disconnected pieces are entered in axis order once the region runs out of frontier
+                if(_frontier.empty()) {
+                    while(_triangle_stamps[_seeds[next_seed].second] != member) {
+                        next_seed++;
+                    }
+
+                    _frontier.push_back(_seeds[next_seed]);
+                }
+
+                std::pop_heap(_frontier.begin(), _frontier.end(), std::greater<>());
+                const auto triangle = _frontier.back().second;
+                _frontier.pop_back();
+
+                if(_triangle_stamps[triangle] != member) {
+                    continue;
+                }
+
+                _triangle_stamps[triangle] = grown;
+                grown_count++;
+
+                for(auto i = _adjacency_offsets[triangle]; i < _adjacency_offsets[triangle + 1]; i++) {
+                    const auto neighbour = _adjacency[i];
+                    if(_triangle_stamps[neighbour] == member) {
+                        _frontier.emplace_back(_centroids[neighbour][axis], neighbour);
+                        std::push_heap(_frontier.begin(), _frontier.end(), std::greater<>());
+                    }
+                }
+            }
+
+            // The region boundary follows the frontier order and leaves teeth: triangles with most of their neighbours on
+            // the other side. Flipping those over smooths the cut, and drops single triangles that would otherwise end up
+            // cut off from the rest of their half.
+            for(size_t pass = 0; pass < _SMOOTHING_PASSES; pass++) {
+                for(auto i = begin; i < end; i++) {
+                    const auto triangle = _triangles[i];
+                    const auto side = _triangle_stamps[triangle];
+
+                    int balance = 0;
+                    for(auto j = _adjacency_offsets[triangle]; j < _adjacency_offsets[triangle + 1]; j++) {
+                        const auto neighbour_side = _triangle_stamps[_adjacency[j]];
+                        if(neighbour_side == member || neighbour_side == grown) {
+                            balance += neighbour_side == side ? 1 : -1;
+                        }
+                    }
+
+                    if(balance < 0) {
+                        _triangle_stamps[triangle] = side == grown ? member : grown;
+                        grown_count += side == grown ? -1 : 1;
+                    }
+                }
+            }
+
+            std::stable_partition(_triangles.begin() + begin, _triangles.begin() + end, [&](uint32_t triangle) noexcept {
+                return _triangle_stamps[triangle] == grown;
+            });
+
+            return grown_count;
+        }
+
+        // Cuts a part of a few meshlets into meshlets. Each one grows from a seed triangle, always taking the connected
+        // triangle closest to the seed that still fits the limits, until it is full or runs out of frontier.
+        void fill_part(size_t begin, size_t end) noexcept {
+            const auto member = ++_triangle_stamp;
+            const auto taken = ++_triangle_stamp;
+
+            _frontier.clear();
+            static_cast<void>(prepare_part(begin, end, member));
+
+            size_t next_seed = 0;
+            while(true) {
+                // Continue next to the previous meshlet, from the free triangle there with the fewest free neighbours, so
+                // the slivers between meshlets get absorbed instead of ending up as meshlets of their own. The first
+                // meshlet, and any piece the previous one didn't touch, starts from the next triangle along the axis.
+                auto seed = ~0u;
+                auto seed_neighbours = ~0u;
+
+                for(const auto& entry : _frontier) {
+                    if(_triangle_stamps[entry.second] != member) {
+                        continue;
+                    }
+
+                    uint32_t neighbours = 0;
+                    for(auto i = _adjacency_offsets[entry.second]; i < _adjacency_offsets[entry.second + 1]; i++) {
+                        neighbours += _triangle_stamps[_adjacency[i]] == member;
+                    }
+
+                    if(neighbours < seed_neighbours || (neighbours == seed_neighbours && entry.second < seed)) {
+                        seed = entry.second;
+                        seed_neighbours = neighbours;
+                    }
+                }
+
+                if(seed == ~0u) {
+                    while(next_seed < _seeds.size() && _triangle_stamps[_seeds[next_seed].second] != member) {
+                        next_seed++;
+                    }
+
+                    if(next_seed == _seeds.size()) {
+                        break;
+                    }
+
+                    seed = _seeds[next_seed].second;
+                }
+
+                const auto center = _centroids[seed];
+
+                _vertex_stamp++;
+                uint32_t vertex_count = 0;
+                auto radius = 0.0f;
+
+                _meshlet_triangles.clear();
+                _frontier.clear();
+                _frontier.emplace_back(0.0f, seed);
+
+                while(_meshlet_triangles.size() < _max_triangles) {
+                    // a piece with no free neighbours left (or a triangle soup) continues with the next free triangle along
+                    // the axis while there is room, unless that would make the meshlet much wider
+                    if(_frontier.empty()) {
+                        while(next_seed < _seeds.size() && _triangle_stamps[_seeds[next_seed].second] != member) {
+                            next_seed++;
+                        }
+
+                        if(next_seed == _seeds.size()) {
+                            break;
+                        }
+
+                        const auto next = _seeds[next_seed].second;
+                        const auto offset = _centroids[next] - center;
+
+                        if(glm::dot(offset, offset) > _JOIN_DISTANCE * _JOIN_DISTANCE * radius * radius || vertex_count + count_new_vertices(next) > _max_vertices) {
+                            break;
+                        }
+
+                        _frontier.push_back(_seeds[next_seed]);
+                    }
+
+                    std::pop_heap(_frontier.begin(), _frontier.end(), std::greater<>());
+                    const auto triangle = _frontier.back().second;
+                    _frontier.pop_back();
+
+                    if(_triangle_stamps[triangle] != member) {
+                        continue;
+                    }
+
+                    const auto new_vertices = count_new_vertices(triangle);
+
+                    // the meshlet's vertices only grow, so a triangle that doesn't fit now never will
+                    if(vertex_count + new_vertices > _max_vertices) {
+                        continue;
+                    }
+
+                    for(size_t j = 0; j < 3; j++) {
+                        _vertex_stamps[_indices[triangle * 3 + j]] = _vertex_stamp;
+                    }
+
+                    radius = std::max(radius, glm::length(_centroids[triangle] - center) + _radii[triangle]);
+                    vertex_count += new_vertices;
+                    _triangle_stamps[triangle] = taken;
+                    _meshlet_triangles.push_back(triangle);
+
+                    for(auto i = _adjacency_offsets[triangle]; i < _adjacency_offsets[triangle + 1]; i++) {
+                        const auto neighbour = _adjacency[i];
+                        if(_triangle_stamps[neighbour] == member) {
+                            const auto offset = _centroids[neighbour] - center;
+                            _frontier.emplace_back(glm::dot(offset, offset), neighbour);
+                            std::push_heap(_frontier.begin(), _frontier.end(), std::greater<>());
+                        }
+                    }
+                }
+
+                // triangle ids follow the source order, which the vertex cache optimization already arranged
+                std::sort(_meshlet_triangles.begin(), _meshlet_triangles.end());
+                emit_meshlet(_meshlet_triangles);
+            }
+        }
+
+        void partition(size_t begin, size_t end) noexcept {
+            const auto triangle_count = end - begin;
+            const auto vertex_count = count_vertices(begin, end);
+
+            if(triangle_count <= _max_triangles && vertex_count <= _max_vertices) {
+                _meshlet_triangles.assign(_triangles.begin() + begin, _triangles.begin() + end);
+                emit_meshlet(_meshlet_triangles);
+                return;
+            }
+
+            const auto part_count = std::max<size_t>({ (triangle_count + _max_triangles - 1) / _max_triangles, (vertex_count + _max_vertices - 1) / _max_vertices, 2 });
+            if(part_count <= _FILL_PART_MESHLETS) {
+                fill_part(begin, end);
+                return;
+            }
+
+            const auto split = bisect(begin, end, triangle_count * (part_count / 2) / part_count);
+            if(split == 0 || split == triangle_count) {
+                fill_part(begin, end);
+                return;
+            }
+
+            partition(begin, begin + split);
+            partition(begin + split, end);
+        }
+    public:
+        graph_partitioner(const uint32_t* indices, size_t index_count, const float* positions, size_t vertex_count, size_t stride,
+                          uint32_t max_vertices, uint32_t max_triangles, meshlet_build& build) noexcept
+            : _indices(indices), _max_vertices(max_vertices), _max_triangles(max_triangles), _build(build) {
+            const auto triangle_count = index_count / 3;
+            const auto stride_floats = stride / sizeof(float);
+
+            const auto get_position = [&](uint32_t index) noexcept {
+                const auto* position = positions + index * stride_floats;
+                return glm::vec3(position[0], position[1], position[2]);
+            };
+
+            _centroids.resize(triangle_count);
+            _radii.resize(triangle_count);
+
+            for(size_t i = 0; i < triangle_count; i++) {
+                const auto a = get_position(indices[i * 3]), b = get_position(indices[i * 3 + 1]), c = get_position(indices[i * 3 + 2]);
+
+                _centroids[i] = (a + b + c) / 3.0f;
+                _radii[i] = glm::max(glm::length(a - _centroids[i]), glm::max(glm::length(b - _centroids[i]), glm::length(c - _centroids[i])));
+            }
+
+            std::vector<uint32_t> shadow_indices(index_count);
+            meshopt_generateShadowIndexBuffer(shadow_indices.data(), indices, index_count, positions, vertex_count, sizeof(float) * 3, stride);
+
+            // position -> incident triangles
+            std::vector<uint32_t> vertex_offsets(vertex_count + 1, 0);
+            for(const auto index : shadow_indices) {
+                vertex_offsets[index + 1]++;
+            }
+
+            for(size_t i = 0; i < vertex_count; i++) {
+                vertex_offsets[i + 1] += vertex_offsets[i];
+            }
+
+            std::vector<uint32_t> vertex_triangles(index_count);
+            {
+                auto fill_offsets = vertex_offsets;
+                for(size_t i = 0; i < index_count; i++) {
+                    vertex_triangles[fill_offsets[shadow_indices[i]]++] = static_cast<uint32_t>(i / 3);
+                }
+            }
+
+            // a triangle is adjacent to every other triangle around its first corner of an edge that also has the second
+            _adjacency_offsets.resize(triangle_count + 1);
+            _adjacency.reserve(index_count);
+
+            for(size_t i = 0; i < triangle_count; i++) {
+                _adjacency_offsets[i] = static_cast<uint32_t>(_adjacency.size());
+
+                for(size_t j = 0; j < 3; j++) {
+                    const auto a = shadow_indices[i * 3 + j], b = shadow_indices[i * 3 + (j + 1) % 3];
+
+                    for(auto k = vertex_offsets[a]; k < vertex_offsets[a + 1]; k++) {
+                        const auto other = vertex_triangles[k];
+                        if(other == i) {
+                            continue;
+                        }
+
+                        if(shadow_indices[other * 3] == b || shadow_indices[other * 3 + 1] == b || shadow_indices[other * 3 + 2] == b) {
+                            _adjacency.push_back(other);
+                        }
+                    }
+                }
+            }
+
+            _adjacency_offsets[triangle_count] = static_cast<uint32_t>(_adjacency.size());
+
+            _triangle_stamps.resize(triangle_count, 0);
+            _vertex_stamps.resize(vertex_count, 0);
+            _local_vertices.resize(vertex_count);
+
+            _triangles.resize(triangle_count);
+            for(size_t i = 0; i < triangle_count; i++) {
+                _triangles[i] = static_cast<uint32_t>(i);
+            }
+        }
+
+        void run() noexcept {
+            _build.meshlets.clear();
+            _build.vertices.clear();
+            _build.triangles.clear();
+
+            if(!_triangles.empty()) {
+                partition(0, _triangles.size());
+            }
+        }
+    };
+
+    void build_graph_meshlets(const uint32_t* indices, size_t index_count, const float* positions, size_t vertex_count, size_t stride,
+                              uint32_t max_vertices, uint32_t max_triangles, meshlet_build& build) noexcept {
+        graph_partitioner partitioner(indices, index_count, positions, vertex_count, stride, max_vertices, max_triangles, build);
+        partitioner.run();
+    }
+}
\ No newline at end of file
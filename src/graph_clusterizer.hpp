@@ -0,0 +1,17 @@
+#pragma once
+
+#include "meshlet_builder.hpp"
+
+#include <cstdint>
+
+namespace d3d12_mesh_shaders {
+    // Alternative to meshopt_buildMeshlets that partitions the triangle adjacency graph instead of growing meshlets
+    // greedily. Triangles are adjacent when they share an edge by position, so UV and normal seams don't cut the graph.
+    // Parts are bisected by growing a connected region from their extreme triangle along their longest axis, always taking
+    // the frontier triangle furthest back along that axis, until the region holds its share of the part's meshlet
+    // estimate; the cut is then smoothed. Parts of a few meshlets are cut into meshlets grown around a seed under the
+    // limits. This favours compact, balanced meshlets over long thin ones, at some cost in meshlet count. Same output layout
+    // as build_meshlets: global vertex indices and 4 byte aligned triangles.
+    void build_graph_meshlets(const uint32_t* indices, size_t index_count, const float* positions, size_t vertex_count, size_t stride,
+                              uint32_t max_vertices, uint32_t max_triangles, meshlet_build& build) noexcept;
+}
\ No newline at end of file
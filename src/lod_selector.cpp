@@ -0,0 +1,45 @@
+#include "lod_selector.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace d3d12_mesh_shaders {
+    lod_selector::lod_selector(const camera& camera, float threshold) noexcept
+        : _camera_position(camera.get_position()), _projection_scale(camera.get_projection_scale()), _threshold(threshold) {}
+
+    lod_selector::lod_selector(const glm::vec3& camera_position, float projection_scale, float threshold) noexcept
+        : _camera_position(camera_position), _projection_scale(projection_scale), _threshold(threshold) {}
+
+    uint32_t lod_selector::select(const mesh& mesh, const glm::mat4& transform) const noexcept {
+        const auto& levels = mesh.get_lod_levels();
+        if(levels.empty()) {
+            return 0;
+        }
+
+        auto min = glm::vec3(std::numeric_limits<float>::max()), max = glm::vec3(-std::numeric_limits<float>::max());
+        for(const auto& submesh : mesh.get_submeshes()) {
+            min = glm::min(min, submesh.bounds_min);
+            max = glm::max(max, submesh.bounds_max);
+        }
+
+        // the largest axis scale keeps the sphere and the errors conservative under non-uniform scaling
+        const auto scale = std::max({ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) });
+        const auto center = glm::vec3(transform * glm::vec4((min + max) * 0.5f, 1.0f));
+        const auto radius = glm::length(max - min) * 0.5f * scale;
+
+        const auto distance = glm::length(center - _camera_position) - radius;
+        if(distance <= 0.0f) {
+            return 0;
+        }
+
+        const auto pixels_per_unit = scale / distance * _projection_scale;
+
+        for(auto level = static_cast<uint32_t>(levels.size()); level > 0; level--) {
+            if(levels[level - 1].error * pixels_per_unit <= _threshold) {
+                return level;
+            }
+        }
+
+        return 0;
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "camera.hpp"
+#include "mesh.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+namespace d3d12_mesh_shaders {
+    // CPU selection over the discrete LOD chain of mesh::get_lod_levels(): per instance, the coarsest level whose error,
+    // projected from the closest point of the instance's bounding sphere, covers at most the threshold in pixels.
+    class lod_selector final {
+    private:
+        glm::vec3 _camera_position;
+        // pixels per object space unit at distance 1, see camera::get_projection_scale
+        float _projection_scale;
+        float _threshold;
+    public:
+        lod_selector(const camera& camera, float threshold) noexcept;
+        lod_selector(const glm::vec3& camera_position, float projection_scale, float threshold) noexcept;
+
+        // 0 is the mesh itself and i > 0 is get_lod_levels()[i - 1]; transform is the instance's model to world matrix
+        [[nodiscard]] uint32_t select(const mesh& mesh, const glm::mat4& transform) const noexcept;
+    };
+}
@@ -0,0 +1,49 @@
+#include "mapped_file.hpp"
+#include "util.hpp"
+
+#include <string>
+
+namespace d3d12_mesh_shaders {
+    mapped_file::mapped_file(const std::string_view& path) noexcept
+        : _file(INVALID_HANDLE_VALUE), _mapping(nullptr), _data(nullptr), _size(0) {
+        // the view needn't be null-terminated, so the API gets a copy that is
+        _file = CreateFileA(std::string(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if(_file == INVALID_HANDLE_VALUE) {
+            return;
+        }
+
+        LARGE_INTEGER size;
+        if(!GetFileSizeEx(_file, &size)) {
+            util::panic("GetFileSizeEx");
+        }
+
+        _size = static_cast<size_t>(size.QuadPart);
+        if(!_size) {
+            return;
+        }
+
+        _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(!_mapping) {
+            util::panic("CreateFileMappingA");
+        }
+
+        _data = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+        if(!_data) {
+            util::panic("MapViewOfFile");
+        }
+    }
+
+    mapped_file::~mapped_file() noexcept {
+        if(_data) {
+            UnmapViewOfFile(_data);
+        }
+
+        if(_mapping) {
+            CloseHandle(_mapping);
+        }
+
+        if(_file != INVALID_HANDLE_VALUE) {
+            CloseHandle(_file);
+        }
+    }
+}
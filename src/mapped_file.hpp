@@ -0,0 +1,34 @@
+#pragma once
+
+#include <windows.h>
+
+#include <string_view>
+
+namespace d3d12_mesh_shaders {
+    class mapped_file final {
+    private:
+        HANDLE _file;
+        HANDLE _mapping;
+        const char* _data;
+        size_t _size;
+
+    public:
+        mapped_file(const std::string_view& path) noexcept;
+        ~mapped_file() noexcept;
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        [[nodiscard]] inline bool is_open() const noexcept {
+            return _file != INVALID_HANDLE_VALUE;
+        }
+
+        [[nodiscard]] inline const char* get_data() const noexcept {
+            return _data;
+        }
+
+        [[nodiscard]] inline size_t get_size() const noexcept {
+            return _size;
+        }
+    };
+}
@@ -1,107 +1,1244 @@
 #include "mesh.hpp"
+#include "cluster_lod.hpp"
+#include "glb_parser.hpp"
+#include "meshlet_builder.hpp"
+#include "meshlet_bvh.hpp"
+#include "meshlet_tuner.hpp"
+#include "normal_generator.hpp"
+#include "obj_parser.hpp"
+#include "ply_parser.hpp"
+#include "scratch_arena.hpp"
+#include "stl_parser.hpp"
+#include "tangent_generator.hpp"
 #include "util.hpp"
 
-#include <fast_obj/fast_obj.h>
 #include <meshoptimizer/meshoptimizer.h>
 
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <string>
+#include <tuple>
+
 namespace d3d12_mesh_shaders {
-    static const size_t _MAX_VERTICES = 64;
-    static const size_t _MAX_TRIANGLES = 124;
+    // triangles with less area than this fraction of the squared largest bounding box extent count as degenerate
+    static const double _DEGENERATE_AREA_EPSILON = 1e-12;
 
-    mesh::mesh(const std::string_view& path) noexcept {
-        auto* obj_mesh = fast_obj_read(path.data());
-        if(!obj_mesh) {
-            util::panic("fast_obj_read");
-        }
+    static const size_t _TRIANGLE_BATCH_SIZE = 1 << 14;
+    static const size_t _MESHLET_BATCH_SIZE = 256;
+
+    // target chunk size of the parallel meshlet build, and the Morton grid resolution per axis used to find the chunks
+    static const size_t _MESHLET_CHUNK_TRIANGLES = 1 << 16;
+    static const uint32_t _MORTON_CELLS = 32;
+
+    // A discrete LOD level aims for half the triangles of the last, without an error bound. meshopt_simplifySloppy takes over
+    // when meshopt_simplify ends above the target by this factor, and the chain stops at a level keeping more than
+    // _LOD_MIN_REDUCTION of the triangles.
+    static const float _LOD_MAX_ERROR = 1.0f;
+    static const float _LOD_SLOPPY_THRESHOLD = 1.5f;
+    static const float _LOD_MIN_REDUCTION = 0.8f;
+
+    struct submesh_range final {
+        uint32_t index_offset;
+        uint32_t index_count;
+        uint32_t material;
+    };
 
+    struct meshlet_chunk final {
+        uint32_t range;
+        uint32_t index_offset;
+        uint32_t index_count;
+    };
+
+    static inline uint32_t hash_uint3(uint32_t a, uint32_t b, uint32_t c) noexcept {
+        auto hash = a * 0x9e3779b1u ^ b * 0x85ebca6bu ^ c * 0xc2b2ae35u;
+        hash ^= hash >> 16;
+        hash *= 0x7feb352du;
+        hash ^= hash >> 15;
+        return hash;
+    }
+
+    // Deduplicates corners on their (p, t, n) triple instead of expanding every corner into a full vertex and hashing those
+    // back together. Faces are fan triangulated on the fly, so the unique vertices and the index buffer come out in one pass.
+    static void weld_obj_vertices(const obj_parser& obj, std::vector<mesh::vertex>& vertices, std::vector<uint32_t>& indices) noexcept {
+        const auto& positions = obj.get_positions();
+        const auto& tex_coords = obj.get_tex_coords();
+        const auto& normals = obj.get_normals();
+        const auto& face_vertices = obj.get_face_vertices();
+        const auto& obj_indices = obj.get_indices();
+
+        // the parser keeps faces with fewer than 3 corners (a bare "f" or a line it bailed out of); they have no triangles
         size_t index_count = 0;
-        for(auto i = 0; i < obj_mesh->face_count; i++) {
-            index_count += 3 * (obj_mesh->face_vertices[i] - 2);
+        for(const auto face_vertex_count : face_vertices) {
+            if(face_vertex_count >= 3) {
+                index_count += 3 * (face_vertex_count - 2);
+            }
+        }
+
+        // Open addressing with triangular probing, sized so the load factor stays below 0.8 even if no corner is shared.
+        size_t table_size = 1;
+        while(table_size < obj_indices.size() + obj_indices.size() / 4) {
+            table_size *= 2;
         }
 
-        std::vector<vertex> vertices(index_count);
+        std::vector<uint32_t> table(table_size, ~0u);
+        std::vector<obj_parser::index> keys;
+
+        keys.reserve(positions.size() / 3);
+        vertices.reserve(positions.size() / 3);
+        indices.resize(index_count);
+
+        const auto weld = [&](const obj_parser::index& index) noexcept {
+            auto bucket = hash_uint3(index.p, index.t, index.n) & (table_size - 1);
+
+            for(size_t probe = 1; ; probe++) {
+                const auto slot = table[bucket];
+
+                if(slot == ~0u) {
+                    const auto vertex_index = static_cast<uint32_t>(keys.size());
+                    table[bucket] = vertex_index;
+                    keys.push_back(index);
+
+                    const auto position_index = index.p * 3;
+                    const auto tex_coord_index = index.t * 2;
+                    const auto normal_index = index.n * 3;
+
+                    // a corner without vn keeps a zero normal so that generate_missing_normals picks it up later
+                    vertices.emplace_back(glm::vec3(positions[position_index], positions[position_index + 1], positions[position_index + 2]),
+                                          glm::vec2(tex_coords[tex_coord_index], tex_coords[tex_coord_index + 1]),
+                                          index.n ? glm::vec3(normals[normal_index], normals[normal_index + 1], normals[normal_index + 2]) : glm::vec3(0.0f));
+                    return vertex_index;
+                }
+
+                const auto& key = keys[slot];
+                if(key.p == index.p && key.t == index.t && key.n == index.n) {
+                    return slot;
+                }
+
+                bucket = (bucket + probe) & (table_size - 1);
+            }
+        };
+
+        size_t index_offset = 0, output_offset = 0;
+        for(const auto face_vertex_count : face_vertices) {
+            if(face_vertex_count < 3) {
+                index_offset += face_vertex_count;
+                continue;
+            }
 
-        size_t vertex_offset = 0, index_offset = 0;
-        for(auto i = 0; i < obj_mesh->face_count; i++) {
-            const auto face_vertices = obj_mesh->face_vertices[i];
+            uint32_t first = 0, previous = 0;
 
-            for(auto j = 0; j < face_vertices; j++) {
-                const auto index = obj_mesh->indices[index_offset + j];
+            for(uint32_t j = 0; j < face_vertex_count; j++) {
+                const auto vertex_index = weld(obj_indices[index_offset + j]);
 
-                if(j >= 3) {
-                    vertices[vertex_offset] = vertices[vertex_offset - 3];
-                    vertices[vertex_offset + 1] = vertices[vertex_offset - 1];
-                    vertex_offset += 2;
+                if(j == 0) {
+                    first = vertex_index;
+                } else if(j >= 2) {
+                    indices[output_offset++] = first;
+                    indices[output_offset++] = previous;
+                    indices[output_offset++] = vertex_index;
                 }
 
-                auto& vertex = vertices[vertex_offset++];
+                previous = vertex_index;
+            }
+
+            index_offset += face_vertex_count;
+        }
+    }
+
+    void mesh::load_obj(const std::string_view& path, std::vector<uint32_t>& indices, std::vector<uint64_t>& triangle_keys) noexcept {
+        const auto parse_start = std::chrono::steady_clock::now();
+
+        const obj_parser obj(path);
+
+        _statistics.parse_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parse_start).count();
+        _statistics.source_bytes = obj.get_source_bytes();
+
+        const auto weld_start = std::chrono::steady_clock::now();
+
+        weld_obj_vertices(obj, _vertices, indices);
+
+        _statistics.weld_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - weld_start).count();
 
-                const auto position_index = index.p * 3;
-                const auto tex_coord_index = index.t * 2;
-                const auto normal_index = index.n * 3;
+        // one submesh per (material, group) pair, keyed material first so every material ends up contiguous
+        const auto& face_vertices = obj.get_face_vertices();
+        const auto& face_materials = obj.get_face_materials();
+        const auto& groups = obj.get_groups();
 
-                vertex.position = glm::vec3(obj_mesh->positions[position_index], obj_mesh->positions[position_index + 1], obj_mesh->positions[position_index + 2]);
-                vertex.tex_coord = glm::vec2(obj_mesh->texcoords[tex_coord_index], obj_mesh->texcoords[tex_coord_index + 1]);
-                vertex.normal = glm::vec3(obj_mesh->normals[normal_index], obj_mesh->normals[normal_index + 1], obj_mesh->normals[normal_index + 2]);
+        triangle_keys.reserve(indices.size() / 3);
+
+        size_t group_index = 0;
+        for(size_t i = 0; i < face_vertices.size(); i++) {
+            while(group_index + 1 < groups.size() && i >= groups[group_index + 1].face_offset) {
+                group_index++;
             }
 
-            index_offset += face_vertices;
+            const auto key = static_cast<uint64_t>(face_materials[i]) << 32 | group_index;
+            for(uint32_t j = 2; j < face_vertices[i]; j++) {
+                triangle_keys.push_back(key);
+            }
         }
+    }
+
+    void mesh::load_ply(const std::string_view& path, std::vector<uint32_t>& indices) noexcept {
+        const auto parse_start = std::chrono::steady_clock::now();
+
+        ply_parser ply(path);
+
+        _statistics.parse_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parse_start).count();
+        _statistics.source_bytes = ply.get_source_bytes();
 
-        fast_obj_destroy(obj_mesh);
+        const auto weld_start = std::chrono::steady_clock::now();
 
+        auto& vertices = ply.get_vertices();
+        indices = std::move(ply.get_indices());
+
+        // PLY is indexed already, but scanners happily emit the same vertex more than once
         std::vector<uint32_t> remap(vertices.size());
-        const auto vertex_count = meshopt_generateVertexRemap(remap.data(), nullptr, index_count, vertices.data(), index_count, sizeof(vertex));
+        const auto vertex_count = meshopt_generateVertexRemap(remap.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(vertex));
 
         _vertices.resize(vertex_count);
-        std::vector<uint32_t> indices(index_count);
 
-        meshopt_remapVertexBuffer(_vertices.data(), vertices.data(), index_count, sizeof(vertex), remap.data());
-        meshopt_remapIndexBuffer(indices.data(), nullptr, index_count, remap.data());
+        meshopt_remapVertexBuffer(_vertices.data(), vertices.data(), vertices.size(), sizeof(vertex), remap.data());
+        meshopt_remapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
 
-        meshopt_optimizeVertexCache(indices.data(), indices.data(), index_count, vertex_count);
-        meshopt_optimizeVertexFetch(_vertices.data(), indices.data(), index_count, _vertices.data(), vertex_count, sizeof(vertex));
+        _statistics.weld_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - weld_start).count();
+    }
+
+    void mesh::load_glb(const std::string_view& path, std::vector<uint32_t>& indices, std::vector<uint64_t>& triangle_keys) noexcept {
+        const auto parse_start = std::chrono::steady_clock::now();
+
+        glb_parser glb(path);
+
+        _vertices = std::move(glb.get_vertices());
+        indices = std::move(glb.get_indices());
 
-        const auto max_meshlets = meshopt_buildMeshletsBound(indices.size(), _MAX_VERTICES, _MAX_TRIANGLES);
-        std::vector<meshopt_Meshlet> meshlets(max_meshlets);
+        const auto& triangle_materials = glb.get_triangle_materials();
+        triangle_keys.resize(triangle_materials.size());
+        for(size_t i = 0; i < triangle_materials.size(); i++) {
+            triangle_keys[i] = static_cast<uint64_t>(triangle_materials[i]) << 32;
+        }
+
+        _statistics.parse_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parse_start).count();
+        _statistics.source_bytes = glb.get_source_bytes();
+        _statistics.weld_seconds = 0.0;
+    }
+
+    void mesh::load_stl(const std::string_view& path, const build_options& options, std::vector<uint32_t>& indices) noexcept {
+        const auto parse_start = std::chrono::steady_clock::now();
+
+        stl_parser stl(path, options.weld_tolerance, options.crease_angle);
+
+        _vertices = std::move(stl.get_vertices());
+        indices = std::move(stl.get_indices());
+
+        _statistics.parse_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parse_start).count();
+        _statistics.source_bytes = stl.get_source_bytes();
+        _statistics.weld_seconds = 0.0;
+    }
+
+    // rotates the smallest index to the front, which keeps the winding
+    static inline std::array<uint32_t, 3> rotate_triangle(const uint32_t* triangle) noexcept {
+        const auto a = triangle[0], b = triangle[1], c = triangle[2];
+
+        if(b < a && b < c) {
+            return { b, c, a };
+        } else if(c < a && c < b) {
+            return { c, a, b };
+        }
+
+        return { a, b, c };
+    }
+
+    // Drops triangles that repeat an index or have next to no area, then every triangle that repeats an earlier one.
+    // Triangles are compared in their rotated form, so a back-to-back pair (double-sided geometry) is not a duplicate.
+    // Survivors keep their order, and the keys are compacted alongside.
+    static void remove_degenerate_triangles(const std::vector<mesh::vertex>& vertices, std::vector<uint32_t>& indices, std::vector<uint64_t>& triangle_keys,
+                                            size_t& degenerate_count, size_t& duplicate_count) noexcept {
+        const auto triangle_count = indices.size() / 3;
+
+        degenerate_count = 0;
+        duplicate_count = 0;
+
+        if(triangle_count == 0) {
+            return;
+        }
+
+        auto min = glm::vec3(std::numeric_limits<float>::max()), max = glm::vec3(-std::numeric_limits<float>::max());
+        for(const auto& vertex : vertices) {
+            min = glm::min(min, vertex.position);
+            max = glm::max(max, vertex.position);
+        }
+
+        const auto extent = static_cast<double>(glm::max(max.x - min.x, glm::max(max.y - min.y, max.z - min.z)));
+
+        // |cross| is twice the area, compared squared to stay clear of the square root
+        const auto min_cross_length = 2.0 * _DEGENERATE_AREA_EPSILON * extent * extent;
+        const auto min_cross_length_squared = min_cross_length * min_cross_length;
+
+        std::vector<uint8_t> keep(triangle_count);
+        util::parallel_for(triangle_count, _TRIANGLE_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                const auto a = indices[i * 3], b = indices[i * 3 + 1], c = indices[i * 3 + 2];
+                if(a == b || b == c || c == a) {
+                    keep[i] = 0;
+                    continue;
+                }
+
+                const auto p0 = glm::dvec3(vertices[a].position), p1 = glm::dvec3(vertices[b].position), p2 = glm::dvec3(vertices[c].position);
+                const auto normal = glm::cross(p1 - p0, p2 - p0);
 
-        std::vector<uint32_t> meshlet_vertices(max_meshlets * _MAX_VERTICES);
-        std::vector<uint8_t> meshlet_triangles(max_meshlets * _MAX_TRIANGLES);
+                keep[i] = glm::dot(normal, normal) > min_cross_length_squared;
+            }
+        });
+
+        size_t table_size = 1;
+        while(table_size < triangle_count + triangle_count / 4) {
+            table_size *= 2;
+        }
+
+        std::vector<uint32_t> table(table_size, ~0u);
+
+        size_t output = 0;
+        for(size_t i = 0; i < triangle_count; i++) {
+            if(!keep[i]) {
+                degenerate_count++;
+                continue;
+            }
+
+            const auto triangle = rotate_triangle(indices.data() + i * 3);
+
+            auto bucket = hash_uint3(triangle[0], triangle[1], triangle[2]) & (table_size - 1);
+            auto duplicate = false;
+
+            for(size_t probe = 1; table[bucket] != ~0u; probe++) {
+                if(rotate_triangle(indices.data() + table[bucket] * 3) == triangle) {
+                    duplicate = true;
+                    break;
+                }
+
+                bucket = (bucket + probe) & (table_size - 1);
+            }
 
-        const auto meshlet_count = meshopt_buildMeshlets(meshlets.data(), meshlet_vertices.data(), meshlet_triangles.data(), indices.data(), indices.size(),
-                                                         &_vertices[0].position.x, _vertices.size(), sizeof(vertex), _MAX_VERTICES, _MAX_TRIANGLES, 0.0f);
+            if(duplicate) {
+                duplicate_count++;
+                continue;
+            }
+
+            table[bucket] = static_cast<uint32_t>(output);
+
+            indices[output * 3] = indices[i * 3];
+            indices[output * 3 + 1] = indices[i * 3 + 1];
+            indices[output * 3 + 2] = indices[i * 3 + 2];
+
+            if(!triangle_keys.empty()) {
+                triangle_keys[output] = triangle_keys[i];
+            }
+
+            output++;
+        }
+
+        indices.resize(output * 3);
+        if(!triangle_keys.empty()) {
+            triangle_keys.resize(output);
+        }
+    }
+
+    // Stable counting sort of the triangles by key. Every distinct key becomes one contiguous index range, ordered by key so
+    // that ranges sharing a material (upper 32 bits) end up next to each other.
+    static std::vector<submesh_range> sort_triangles_by_key(std::vector<uint32_t>& indices, const std::vector<uint64_t>& triangle_keys) noexcept {
+        const auto triangle_count = indices.size() / 3;
 
-        _meshlets.resize((meshlet_count + 31) & ~31);
+        if(indices.empty()) {
+            return {};
+        }
 
-        size_t num_meshlet_data = 0;
-        for(auto i = 0; i < meshlet_count; i++) {
-            const auto& meshlet = meshlets[i];
+        if(triangle_keys.empty()) {
+            return { submesh_range { 0, static_cast<uint32_t>(indices.size()), 0 } };
+        }
+
+        std::vector<uint64_t> keys(triangle_keys);
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+        std::vector<size_t> offsets(keys.size() + 1, 0);
+        std::vector<uint32_t> triangle_ranges(triangle_count);
+
+        for(size_t i = 0; i < triangle_count; i++) {
+            const auto range = static_cast<uint32_t>(std::lower_bound(keys.begin(), keys.end(), triangle_keys[i]) - keys.begin());
+            triangle_ranges[i] = range;
+            offsets[range + 1] += 3;
+        }
+
+        for(size_t i = 0; i < keys.size(); i++) {
+            offsets[i + 1] += offsets[i];
+        }
+
+        std::vector<submesh_range> ranges(keys.size());
+        for(size_t i = 0; i < keys.size(); i++) {
+            ranges[i] = submesh_range { static_cast<uint32_t>(offsets[i]), static_cast<uint32_t>(offsets[i + 1] - offsets[i]), static_cast<uint32_t>(keys[i] >> 32) };
+        }
+
+        std::vector<uint32_t> sorted_indices(indices.size());
+        for(size_t i = 0; i < triangle_count; i++) {
+            auto& offset = offsets[triangle_ranges[i]];
+
+            sorted_indices[offset++] = indices[i * 3];
+            sorted_indices[offset++] = indices[i * 3 + 1];
+            sorted_indices[offset++] = indices[i * 3 + 2];
+        }
+
+        indices = std::move(sorted_indices);
+        return ranges;
+    }
+
+    static inline uint32_t spread_morton_bits(uint32_t value) noexcept {
+        value = (value | value << 8) & 0x0300f00fu;
+        value = (value | value << 4) & 0x030c30c3u;
+        value = (value | value << 2) & 0x09249249u;
+        return value;
+    }
+
+    // Splits every submesh range that is larger than two chunks into spatially coherent chunks of roughly chunk_triangles
+    // triangles, so the meshlets of one big submesh can be built on several threads. Triangles are counting sorted by the
+    // Morton code of their centroid on a grid of cubic cells, 32 along the largest extent of the submesh bounds (per-axis
+    // cells would slice thin geometry into slivers that share no edges); the sort is stable, so each chunk keeps the
+    // vertex cache order. A chunk_triangles of 0 keeps every range in one piece.
+    static std::vector<meshlet_chunk> partition_triangles(std::vector<uint32_t>& indices, const std::vector<submesh_range>& ranges,
+                                                          const std::vector<mesh::submesh>& submeshes, const std::vector<mesh::vertex>& vertices,
+                                                          size_t chunk_triangles) noexcept {
+        std::vector<meshlet_chunk> chunks;
+
+        std::vector<uint32_t> codes, sorted_indices;
+        for(size_t i = 0; i < ranges.size(); i++) {
+            const auto& range = ranges[i];
+            const auto triangle_count = range.index_count / 3;
+
+            if(chunk_triangles == 0 || triangle_count <= 2 * chunk_triangles) {
+                chunks.push_back(meshlet_chunk { static_cast<uint32_t>(i), range.index_offset, range.index_count });
+                continue;
+            }
+
+            auto* range_indices = indices.data() + range.index_offset;
+
+            const auto& bounds_min = submeshes[i].bounds_min;
+            const auto extent = submeshes[i].bounds_max - bounds_min;
+            const auto scale = glm::vec3(_MORTON_CELLS / std::max(glm::max(extent.x, glm::max(extent.y, extent.z)), std::numeric_limits<float>::min()));
+
+            codes.resize(triangle_count);
+            util::parallel_for(triangle_count, _TRIANGLE_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+                for(auto j = begin; j < end; j++) {
+                    const auto centroid = (vertices[range_indices[j * 3]].position + vertices[range_indices[j * 3 + 1]].position
+                                         + vertices[range_indices[j * 3 + 2]].position) / 3.0f;
+
+                    const auto cell = glm::min(glm::uvec3(glm::max((centroid - bounds_min) * scale, glm::vec3(0.0f))), glm::uvec3(_MORTON_CELLS - 1));
+                    codes[j] = spread_morton_bits(cell.x) | spread_morton_bits(cell.y) << 1 | spread_morton_bits(cell.z) << 2;
+                }
+            });
+
+            std::vector<uint32_t> offsets(_MORTON_CELLS * _MORTON_CELLS * _MORTON_CELLS + 1, 0);
+            for(const auto code : codes) {
+                offsets[code + 1]++;
+            }
+
+            for(size_t j = 0; j + 1 < offsets.size(); j++) {
+                offsets[j + 1] += offsets[j];
+            }
+
+            // close a chunk at the first cell boundary past the target size, cells are never split
+            auto chunk_start = 0u;
+            for(size_t j = 1; j < offsets.size(); j++) {
+                if(offsets[j] - chunk_start >= chunk_triangles || j + 1 == offsets.size()) {
+                    if(offsets[j] > chunk_start) {
+                        chunks.push_back(meshlet_chunk { static_cast<uint32_t>(i), range.index_offset + chunk_start * 3, (offsets[j] - chunk_start) * 3 });
+                    }
+
+                    chunk_start = offsets[j];
+                }
+            }
+
+            sorted_indices.resize(range.index_count);
+            for(size_t j = 0; j < triangle_count; j++) {
+                const auto offset = offsets[codes[j]]++ * 3;
+
+                sorted_indices[offset] = range_indices[j * 3];
+                sorted_indices[offset + 1] = range_indices[j * 3 + 1];
+                sorted_indices[offset + 2] = range_indices[j * 3 + 2];
+            }
+
+            std::copy(sorted_indices.begin(), sorted_indices.end(), range_indices);
+        }
+
+        return chunks;
+    }
+
+    static void optimize_packed_meshlets(const std::vector<mesh::meshlet>& meshlets, std::vector<uint32_t>& meshlet_data) noexcept {
+        util::parallel_for(meshlets.size(), _MESHLET_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                const auto& meshlet = meshlets[i];
+                auto* meshlet_vertices = meshlet_data.data() + meshlet.data_offset;
+
+                optimize_meshlet(meshlet_vertices, reinterpret_cast<uint8_t*>(meshlet_vertices + meshlet.vertex_count), meshlet.vertex_count, meshlet.triangle_count);
+            }
+        });
+    }
+
+    // Optimizes every meshlet, then renumbers the vertices in the order the meshlets first reference them. The vertex order
+    // chosen before clusterization follows the index buffer, which the chunked meshlet build no longer does.
+    static void optimize_meshlets(const std::vector<mesh::meshlet>& meshlets, std::vector<uint32_t>& meshlet_data, std::vector<mesh::vertex>& vertices,
+                                  std::vector<uint32_t>& tangents) noexcept {
+        optimize_packed_meshlets(meshlets, meshlet_data);
+
+        // vertices no meshlet references are dropped
+        std::vector<uint32_t> remap(vertices.size(), ~0u);
+        uint32_t vertex_count = 0;
+
+        for(const auto& meshlet : meshlets) {
+            for(uint32_t i = 0; i < meshlet.vertex_count; i++) {
+                auto& vertex = remap[meshlet_data[meshlet.data_offset + i]];
+                if(vertex == ~0u) {
+                    vertex = vertex_count++;
+                }
+            }
+        }
+
+        meshopt_remapVertexBuffer(vertices.data(), vertices.data(), vertices.size(), sizeof(mesh::vertex), remap.data());
+        vertices.resize(vertex_count);
+
+        if(!tangents.empty()) {
+            meshopt_remapVertexBuffer(tangents.data(), tangents.data(), tangents.size(), sizeof(uint32_t), remap.data());
+            tangents.resize(vertex_count);
+        }
+
+        for(const auto& meshlet : meshlets) {
+            for(uint32_t i = 0; i < meshlet.vertex_count; i++) {
+                auto& vertex = meshlet_data[meshlet.data_offset + i];
+                vertex = remap[vertex];
+            }
+        }
+    }
+
+    // Maps every vertex to the first with its exact position and marks the positions on the border between submeshes,
+    // which LOD simplification must leave where they are or the submeshes would crack apart.
+    static void find_submesh_borders(const std::vector<mesh::vertex>& vertices, const std::vector<mesh::meshlet>& meshlets, const std::vector<uint32_t>& meshlet_data,
+                                     const std::vector<mesh::submesh>& submeshes, std::vector<uint32_t>& position_remap, std::vector<uint8_t>& locked_positions) noexcept {
+        std::vector<uint32_t> order(vertices.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) noexcept {
+            const auto& pa = vertices[a].position;
+            const auto& pb = vertices[b].position;
+            return std::tie(pa.x, pa.y, pa.z, a) < std::tie(pb.x, pb.y, pb.z, b);
+        });
+
+        position_remap.resize(vertices.size());
+        for(size_t i = 0; i < order.size(); i++) {
+            position_remap[order[i]] = i > 0 && vertices[order[i - 1]].position == vertices[order[i]].position ? position_remap[order[i - 1]] : order[i];
+        }
+
+        std::vector<uint32_t> position_submeshes(vertices.size(), ~0u);
+        locked_positions.assign(vertices.size(), 0);
+
+        for(uint32_t i = 0; i < submeshes.size(); i++) {
+            for(auto j = submeshes[i].meshlet_offset; j < submeshes[i].meshlet_offset + submeshes[i].meshlet_count; j++) {
+                for(uint32_t k = 0; k < meshlets[j].vertex_count; k++) {
+                    const auto position = position_remap[meshlet_data[meshlets[j].data_offset + k]];
+                    if(position_submeshes[position] == ~0u) {
+                        position_submeshes[position] = i;
+                    } else if(position_submeshes[position] != i) {
+                        locked_positions[position] = 1;
+                    }
+                }
+            }
+        }
+    }
+
+    // one DAG per submesh, so no cluster mixes materials; the groups of each level are simplified on all cores
+    static void build_lod_meshlets(const mesh::meshlet_parameters& parameters, const std::vector<mesh::vertex>& vertices, const std::vector<mesh::meshlet>& meshlets,
+                                   const std::vector<uint32_t>& meshlet_data, bool optimize, std::vector<mesh::submesh>& submeshes,
+                                   std::vector<mesh::meshlet>& lod_meshlets, std::vector<uint32_t>& lod_meshlet_data, std::vector<mesh::lod_cluster>& lod_clusters) noexcept {
+        std::vector<uint32_t> position_remap;
+        std::vector<uint8_t> locked_positions;
+        find_submesh_borders(vertices, meshlets, meshlet_data, submeshes, position_remap, locked_positions);
+
+        std::vector<meshlet_build> builds(submeshes.size());
+
+        uint32_t lod_meshlet_offset = 0;
+        for(size_t i = 0; i < submeshes.size(); i++) {
+            auto& submesh = submeshes[i];
+
+            build_cluster_lod(parameters, vertices, position_remap, locked_positions, std::span(meshlets.data() + submesh.meshlet_offset, submesh.meshlet_count), meshlet_data,
+                              builds[i], lod_clusters);
+
+            submesh.lod_meshlet_offset = lod_meshlet_offset;
+            submesh.lod_meshlet_count = static_cast<uint32_t>(builds[i].meshlets.size());
+            lod_meshlet_offset += submesh.lod_meshlet_count;
+        }
+
+        pack_meshlets(builds, lod_meshlets, lod_meshlet_data);
+        lod_clusters.resize(lod_meshlets.size(), mesh::lod_cluster {});
+
+        if(optimize) {
+            optimize_packed_meshlets(lod_meshlets, lod_meshlet_data);
+        }
+    }
+
+    // Moves the meshlets of every submesh to a group boundary of their own and pads the tail of its last group, so no group
+    // of MESHLET_GROUP_SIZE mixes two submeshes and the group bounds only ever cover one material. The meshlet data stays
+    // where it is.
+    static void align_submesh_meshlets(std::vector<mesh::submesh>& submeshes, std::vector<mesh::meshlet>& meshlets) noexcept {
+        const auto get_aligned_count = [](size_t count) noexcept {
+            return (count + mesh::MESHLET_GROUP_SIZE - 1) / mesh::MESHLET_GROUP_SIZE * mesh::MESHLET_GROUP_SIZE;
+        };
+
+        size_t aligned_count = 0;
+        for(const auto& submesh : submeshes) {
+            aligned_count += get_aligned_count(submesh.meshlet_count);
+        }
+
+        std::vector<mesh::meshlet> aligned_meshlets(aligned_count);
+
+        size_t meshlet_offset = 0;
+        for(auto& submesh : submeshes) {
+            std::copy_n(meshlets.begin() + submesh.meshlet_offset, submesh.meshlet_count, aligned_meshlets.begin() + meshlet_offset);
+
+            submesh.meshlet_offset = static_cast<uint32_t>(meshlet_offset);
+            meshlet_offset += get_aligned_count(submesh.meshlet_count);
+        }
+
+        meshlets = std::move(aligned_meshlets);
+    }
+
+    // The packed meshlet data is exactly the vertex list plus byte triangle list that meshopt_computeMeshletBounds reads.
+    static void compute_meshlet_bounds(const std::vector<mesh::meshlet>& meshlets, const std::vector<uint32_t>& meshlet_data,
+                                       const std::vector<mesh::vertex>& vertices, std::vector<mesh::meshlet_bounds>& meshlet_bounds) noexcept {
+        meshlet_bounds.assign(meshlets.size(), mesh::meshlet_bounds {});
+
+        util::parallel_for(meshlets.size(), _MESHLET_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                const auto& meshlet = meshlets[i];
+                if(meshlet.triangle_count == 0) {
+                    continue;
+                }
+
+                const auto* meshlet_vertices = meshlet_data.data() + meshlet.data_offset;
+                const auto* meshlet_triangles = reinterpret_cast<const uint8_t*>(meshlet_vertices + meshlet.vertex_count);
+
+                const auto bounds = meshopt_computeMeshletBounds(meshlet_vertices, meshlet_triangles, meshlet.triangle_count, &vertices[0].position.x,
+                                                                 vertices.size(), sizeof(mesh::vertex));
+
+                auto& result = meshlet_bounds[i];
+                result.center = glm::vec3(bounds.center[0], bounds.center[1], bounds.center[2]);
+                result.radius = bounds.radius;
+                result.cone_apex = glm::vec3(bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2]);
+                result.cone_axis[0] = bounds.cone_axis_s8[0];
+                result.cone_axis[1] = bounds.cone_axis_s8[1];
+                result.cone_axis[2] = bounds.cone_axis_s8[2];
+                result.cone_cutoff = bounds.cone_cutoff_s8;
+            }
+        });
+    }
+
+    // Splits [begin, end) of order at the group boundary nearest the median of the sphere centers along the longest axis of
+    // their box, and recurses until no range straddles a group boundary.
+    static void split_meshlets(uint32_t* order, size_t begin, size_t end, const std::vector<mesh::meshlet_bounds>& meshlet_bounds) noexcept {
+        const auto first_group = begin / mesh::MESHLET_GROUP_SIZE, last_group = (end - 1) / mesh::MESHLET_GROUP_SIZE;
+        if(first_group == last_group) {
+            return;
+        }
 
-            num_meshlet_data += meshlet.vertex_count;
-            num_meshlet_data += (meshlet.triangle_count * 3 + 3) / 4;
+        auto min = glm::vec3(std::numeric_limits<float>::max()), max = glm::vec3(-std::numeric_limits<float>::max());
+        for(auto i = begin; i < end; i++) {
+            min = glm::min(min, meshlet_bounds[order[i]].center);
+            max = glm::max(max, meshlet_bounds[order[i]].center);
         }
 
-        _meshlet_data.resize(num_meshlet_data);
+        const auto extent = max - min;
+        const auto axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+
+        const auto middle_group = std::clamp((begin + end) / 2 + mesh::MESHLET_GROUP_SIZE / 2, (first_group + 1) * mesh::MESHLET_GROUP_SIZE,
+                                             last_group * mesh::MESHLET_GROUP_SIZE) / mesh::MESHLET_GROUP_SIZE;
+        const auto split = middle_group * mesh::MESHLET_GROUP_SIZE;
+
+        std::nth_element(order + begin, order + split, order + end, [&](uint32_t a, uint32_t b) noexcept {
+            return meshlet_bounds[a].center[axis] < meshlet_bounds[b].center[axis];
+        });
+
+        split_meshlets(order, begin, split, meshlet_bounds);
+        split_meshlets(order, split, end, meshlet_bounds);
+    }
+
+    // Reorders the meshlets of every submesh so each group of MESHLET_GROUP_SIZE covers a compact region, by median splits
+    // on group boundaries, and repacks the meshlet data in the new order. Submeshes start on a group boundary, see
+    // align_submesh_meshlets, so no group straddles two.
+    static void sort_meshlets_spatially(const std::vector<mesh::submesh>& submeshes, std::vector<mesh::meshlet>& meshlets, std::vector<uint32_t>& meshlet_data,
+                                        std::vector<mesh::meshlet_bounds>& meshlet_bounds) noexcept {
+        std::vector<uint32_t> order(meshlets.size());
+        std::iota(order.begin(), order.end(), 0u);
+
+        util::parallel_for(submeshes.size(), 1, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                const auto& submesh = submeshes[i];
+                if(submesh.meshlet_count > 0) {
+                    split_meshlets(order.data(), submesh.meshlet_offset, submesh.meshlet_offset + submesh.meshlet_count, meshlet_bounds);
+                }
+            }
+        });
+
+        std::vector<mesh::meshlet> sorted_meshlets(meshlets.size());
+        std::vector<mesh::meshlet_bounds> sorted_bounds(meshlets.size());
+        std::vector<uint32_t> sorted_data(meshlet_data.size());
 
         size_t index = 0;
+        for(size_t i = 0; i < order.size(); i++) {
+            const auto& meshlet = meshlets[order[i]];
+            if(meshlet.triangle_count == 0) {
+                sorted_meshlets[i] = meshlet;
+                continue;
+            }
+
+            const auto word_count = meshlet.vertex_count + (meshlet.triangle_count * 3 + 3) / 4;
+            std::copy(meshlet_data.begin() + meshlet.data_offset, meshlet_data.begin() + meshlet.data_offset + word_count, sorted_data.begin() + index);
+
+            sorted_meshlets[i] = mesh::meshlet(static_cast<uint32_t>(index), meshlet.vertex_count, meshlet.triangle_count);
+            sorted_bounds[i] = meshlet_bounds[order[i]];
+            index += word_count;
+        }
+
+        meshlets = std::move(sorted_meshlets);
+        meshlet_bounds = std::move(sorted_bounds);
+        meshlet_data = std::move(sorted_data);
+    }
+
+    // The group sphere bounds the meshlet spheres around the center of their box. The group cone takes the mean meshlet
+    // axis and widens it to contain every meshlet cone: a cutoff is the sine of the cone's half angle (meshopt stores the
+    // cosine of its complement), so half angles add up along the angle between the axes. The 8 bit axes and cutoffs are
+    // conservative together, so the group cone is too.
+    static void compute_meshlet_group_bounds(const std::vector<mesh::meshlet>& meshlets, const std::vector<mesh::meshlet_bounds>& meshlet_bounds,
+                                             std::vector<mesh::meshlet_group_bounds>& group_bounds) noexcept {
+        group_bounds.assign(meshlets.size() / mesh::MESHLET_GROUP_SIZE, mesh::meshlet_group_bounds {});
+
+        util::parallel_for(group_bounds.size(), _MESHLET_BATCH_SIZE / mesh::MESHLET_GROUP_SIZE, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                const auto first = i * mesh::MESHLET_GROUP_SIZE;
+
+                // padding only ever fills the tail of the last group
+                auto last = first + 1;
+                while(last < first + mesh::MESHLET_GROUP_SIZE && meshlets[last].triangle_count > 0) {
+                    last++;
+                }
+
+                auto min = glm::vec3(std::numeric_limits<float>::max()), max = glm::vec3(-std::numeric_limits<float>::max());
+                for(auto j = first; j < last; j++) {
+                    min = glm::min(min, meshlet_bounds[j].center - meshlet_bounds[j].radius);
+                    max = glm::max(max, meshlet_bounds[j].center + meshlet_bounds[j].radius);
+                }
+
+                auto& result = group_bounds[i];
+                result.center = (min + max) * 0.5f;
+                result.cone_cutoff = 1.0f;
+
+                for(auto j = first; j < last; j++) {
+                    result.radius = std::max(result.radius, glm::length(meshlet_bounds[j].center - result.center) + meshlet_bounds[j].radius);
+                }
+
+                const auto get_cone_axis = [&](size_t j) noexcept {
+                    const auto& bounds = meshlet_bounds[j];
+                    return glm::vec3(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]) / 127.0f;
+                };
+
+                auto axis = glm::vec3(0.0f);
+                for(auto j = first; j < last; j++) {
+                    if(meshlet_bounds[j].cone_cutoff == 127) {
+                        axis = glm::vec3(0.0f);
+                        break;
+                    }
+
+                    axis += get_cone_axis(j);
+                }
+
+                if(glm::length(axis) < 1e-3f) {
+                    continue;
+                }
+
+                result.cone_axis = glm::normalize(axis);
+
+                auto half_angle = 0.0f;
+                for(auto j = first; j < last; j++) {
+                    const auto angle = glm::acos(glm::clamp(glm::dot(result.cone_axis, glm::normalize(get_cone_axis(j))), -1.0f, 1.0f));
+                    half_angle = std::max(half_angle, angle + glm::asin(meshlet_bounds[j].cone_cutoff / 127.0f));
+                }
+
+                if(half_angle < glm::half_pi<float>()) {
+                    result.cone_cutoff = glm::sin(half_angle);
+                }
+            }
+        });
+    }
+
+    // Every level simplifies each submesh of the last to half its triangles. meshopt_simplify keeps attribute seams and the
+    // mesh border in place, and the positions a submesh shares with others are locked like the group borders of
+    // build_cluster_lod, so neighbouring submeshes keep meeting along the same edges. Where meshopt_simplify stalls well
+    // short of the target, meshopt_simplifySloppy, which keeps nothing, is used instead, but only on submeshes without
+    // locked positions. The chain ends early once a level no longer saves enough.
+    static void build_lod_levels(const mesh::meshlet_parameters& parameters, const std::vector<mesh::vertex>& vertices, const std::vector<mesh::meshlet>& meshlets,
+                                 const std::vector<uint32_t>& meshlet_data, const std::vector<mesh::submesh>& submeshes, uint32_t level_count, bool optimize,
+                                 std::vector<mesh::lod_level>& levels) noexcept {
+        // the triangles of the full mesh come from its meshlets, since optimize_meshlets renumbers the vertices
+        std::vector<std::vector<uint32_t>> submesh_indices(submeshes.size());
+        size_t triangle_count = 0;
+
+        for(size_t i = 0; i < submeshes.size(); i++) {
+            for(auto j = submeshes[i].meshlet_offset; j < submeshes[i].meshlet_offset + submeshes[i].meshlet_count; j++) {
+                const auto& meshlet = meshlets[j];
+                const auto* meshlet_vertices = meshlet_data.data() + meshlet.data_offset;
+                const auto* meshlet_triangles = reinterpret_cast<const uint8_t*>(meshlet_vertices + meshlet.vertex_count);
+
+                for(uint32_t k = 0; k < meshlet.triangle_count * 3; k++) {
+                    submesh_indices[i].push_back(meshlet_vertices[meshlet_triangles[k]]);
+                }
+
+                triangle_count += meshlet.triangle_count;
+            }
+        }
+
+        if(triangle_count == 0) {
+            return;
+        }
+
+        std::vector<uint32_t> position_remap;
+        std::vector<uint8_t> locked_positions;
+        find_submesh_borders(vertices, meshlets, meshlet_data, submeshes, position_remap, locked_positions);
+
+        auto error = 0.0f;
 
-        for(auto i = 0; i < meshlet_count; i++) {
-            const auto& meshlet = meshlets[i];
+        for(uint32_t level = 0; level < level_count; level++) {
+            std::vector<float> errors(submeshes.size(), 0.0f);
+            std::vector<meshlet_build> builds(submeshes.size());
 
-            const auto data_offset = index;
+            util::parallel_for(submeshes.size(), 1, [&](size_t begin, size_t end) noexcept {
+                for(auto i = begin; i < end; i++) {
+                    auto& indices = submesh_indices[i];
+                    const auto target_index_count = indices.size() / 6 * 3;
 
-            for(auto j = 0; j < meshlet.vertex_count; j++) {
-                _meshlet_data[index++] = meshlet_vertices[meshlet.vertex_offset + j];
+                    // simplified over the submesh's own vertices, so the unused copies only lock what it shares
+                    std::vector<uint32_t> local_vertices(indices);
+                    std::sort(local_vertices.begin(), local_vertices.end());
+                    local_vertices.erase(std::unique(local_vertices.begin(), local_vertices.end()), local_vertices.end());
+
+                    std::vector<uint32_t> local_indices(indices.size());
+                    for(size_t j = 0; j < indices.size(); j++) {
+                        local_indices[j] = static_cast<uint32_t>(std::lower_bound(local_vertices.begin(), local_vertices.end(), indices[j]) - local_vertices.begin());
+                    }
+
+                    std::vector<glm::vec3> positions(local_vertices.size());
+                    for(size_t j = 0; j < local_vertices.size(); j++) {
+                        positions[j] = vertices[local_vertices[j]].position;
+                    }
+
+                    // meshopt's errors are relative to the extent of the positions
+                    const auto scale = positions.empty() ? 0.0f : meshopt_simplifyScale(&positions[0].x, positions.size(), sizeof(glm::vec3));
+
+                    for(size_t j = 0; j < local_vertices.size(); j++) {
+                        if(locked_positions[position_remap[local_vertices[j]]]) {
+                            positions.push_back(positions[j]);
+                        }
+                    }
+
+                    const auto has_locked_positions = positions.size() > local_vertices.size();
+
+                    std::vector<uint32_t> simplified(indices.size());
+                    if(!indices.empty()) {
+                        simplified.resize(meshopt_simplify(simplified.data(), local_indices.data(), local_indices.size(), &positions[0].x, positions.size(),
+                                                           sizeof(glm::vec3), target_index_count, _LOD_MAX_ERROR, &errors[i]));
+                    }
+
+                    if(!has_locked_positions && static_cast<float>(simplified.size()) > static_cast<float>(target_index_count) * _LOD_SLOPPY_THRESHOLD) {
+                        simplified.resize(indices.size());
+                        simplified.resize(meshopt_simplifySloppy(simplified.data(), local_indices.data(), local_indices.size(), &positions[0].x, positions.size(),
+                                                                 sizeof(glm::vec3), target_index_count, _LOD_MAX_ERROR, &errors[i]));
+                    }
+
+                    errors[i] *= scale;
+
+                    for(auto& index : simplified) {
+                        index = local_vertices[index];
+                    }
+
+                    if(!simplified.empty()) {
+                        meshopt_optimizeVertexCache(simplified.data(), simplified.data(), simplified.size(), vertices.size());
+                        build_meshlets(parameters, simplified.data(), simplified.size(), vertices, builds[i]);
+                    }
+
+                    indices = std::move(simplified);
+                }
+            });
+
+            size_t level_triangle_count = 0;
+            for(const auto& indices : submesh_indices) {
+                level_triangle_count += indices.size() / 3;
+            }
+
+            if(level_triangle_count == 0 || static_cast<float>(level_triangle_count) > static_cast<float>(triangle_count) * _LOD_MIN_REDUCTION) {
+                break;
+            }
+
+            triangle_count = level_triangle_count;
+            error += *std::max_element(errors.begin(), errors.end());
+
+            auto& lod = levels.emplace_back();
+            lod.error = error;
+            lod.triangle_count = triangle_count;
+            lod.submeshes = submeshes;
+
+            uint32_t meshlet_offset = 0;
+            for(size_t i = 0; i < submeshes.size(); i++) {
+                auto& submesh = lod.submeshes[i];
+                submesh.meshlet_offset = meshlet_offset;
+                submesh.meshlet_count = static_cast<uint32_t>(builds[i].meshlets.size());
+                submesh.lod_meshlet_offset = 0;
+                submesh.lod_meshlet_count = 0;
+                meshlet_offset += submesh.meshlet_count;
+            }
+
+            pack_meshlets(builds, lod.meshlets, lod.meshlet_data);
+
+            if(optimize) {
+                optimize_packed_meshlets(lod.meshlets, lod.meshlet_data);
+            }
+
+            compute_meshlet_bounds(lod.meshlets, lod.meshlet_data, vertices, lod.bounds);
+        }
+    }
+
+    // Depth and shadow passes read nothing but positions, so to them vertices split by a UV or normal seam are one vertex
+    // and materials don't matter. meshopt_generateShadowIndexBuffer maps every vertex to the first with its position, and
+    // the whole mesh is clusterized again on that index buffer, in chunks cut from the meshlets in order so each stays
+    // spatially coherent; without the seams and submesh borders the meshlets fill up better. The positions the shadow
+    // meshlets reference are then copied out in meshlet order into a stream of their own.
+    static void build_shadow_meshlets(const mesh::meshlet_parameters& parameters, const mesh::build_options& options, const std::vector<mesh::vertex>& vertices,
+                                      const std::vector<mesh::meshlet>& meshlets, const std::vector<uint32_t>& meshlet_data, std::vector<glm::vec3>& shadow_positions,
+                                      std::vector<mesh::meshlet>& shadow_meshlets, std::vector<uint32_t>& shadow_meshlet_data,
+                                      std::vector<mesh::meshlet_bounds>& shadow_meshlet_bounds) noexcept {
+        std::vector<uint32_t> indices;
+
+        for(const auto& meshlet : meshlets) {
+            const auto* meshlet_vertices = meshlet_data.data() + meshlet.data_offset;
+            const auto* meshlet_triangles = reinterpret_cast<const uint8_t*>(meshlet_vertices + meshlet.vertex_count);
+
+            for(uint32_t i = 0; i < meshlet.triangle_count * 3; i++) {
+                indices.push_back(meshlet_vertices[meshlet_triangles[i]]);
             }
+        }
 
-            const auto* packed_indices = reinterpret_cast<const uint32_t*>(meshlet_triangles.data() + meshlet.triangle_offset);
-            const auto num_packed_indices = (meshlet.triangle_count * 3 + 3) / 4;
+        if(indices.empty()) {
+            return;
+        }
+
+        meshopt_generateShadowIndexBuffer(indices.data(), indices.data(), indices.size(), &vertices[0].position.x, vertices.size(), sizeof(glm::vec3),
+                                          sizeof(mesh::vertex));
+
+        const auto chunk_index_count = _MESHLET_CHUNK_TRIANGLES * 3;
+        std::vector<meshlet_build> builds((indices.size() + chunk_index_count - 1) / chunk_index_count);
 
-            for(auto j = 0; j < num_packed_indices; j++) {
-                _meshlet_data[index++] = packed_indices[j];
+        util::parallel_for(builds.size(), 1, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                const auto index_offset = i * chunk_index_count;
+                build_meshlets(parameters, indices.data() + index_offset, std::min(indices.size() - index_offset, chunk_index_count), vertices, builds[i]);
+
+                if(options.merge_small_meshlets) {
+                    static_cast<void>(merge_meshlets(parameters, vertices, builds[i]));
+                }
             }
+        });
+
+        uint32_t meshlet_count = 0;
+        for(const auto& build : builds) {
+            meshlet_count += static_cast<uint32_t>(build.meshlets.size());
+        }
+
+        pack_meshlets(builds, shadow_meshlets, shadow_meshlet_data);
+        compute_meshlet_bounds(shadow_meshlets, shadow_meshlet_data, vertices, shadow_meshlet_bounds);
+
+        if(options.group_meshlets) {
+            std::vector<mesh::submesh> whole_mesh(1);
+            whole_mesh[0].meshlet_offset = 0;
+            whole_mesh[0].meshlet_count = meshlet_count;
+
+            sort_meshlets_spatially(whole_mesh, shadow_meshlets, shadow_meshlet_data, shadow_meshlet_bounds);
+        }
+
+        if(options.optimize_meshlets) {
+            optimize_packed_meshlets(shadow_meshlets, shadow_meshlet_data);
+        }
+
+        std::vector<uint32_t> remap(vertices.size(), ~0u);
+
+        for(const auto& meshlet : shadow_meshlets) {
+            for(uint32_t i = 0; i < meshlet.vertex_count; i++) {
+                auto& vertex = shadow_meshlet_data[meshlet.data_offset + i];
+                if(remap[vertex] == ~0u) {
+                    remap[vertex] = static_cast<uint32_t>(shadow_positions.size());
+                    shadow_positions.push_back(vertices[vertex].position);
+                }
 
-            new (_meshlets.data() + i) d3d12_mesh_shaders::mesh::meshlet(data_offset, vertex_count, meshlet.triangle_count);
+                vertex = remap[vertex];
+            }
         }
     }
-}
\ No newline at end of file
+
+    mesh::mesh(const std::string_view& path) noexcept
+        : mesh(path, build_options()) {}
+
+    mesh::mesh(const std::string_view& path, const build_options& options) noexcept {
+        const auto start = std::chrono::steady_clock::now();
+        const auto full_quality = options.quality == build_quality::full;
+
+        scratch_arena::install();
+        const scratch_arena::scope scratch_scope;
+
+        const auto is_cancelled = [&]() noexcept {
+            return options.cancel && options.cancel->load(std::memory_order_relaxed);
+        };
+
+        std::vector<uint32_t> indices;
+        std::vector<uint64_t> triangle_keys;
+
+        if(path.ends_with(".ply")) {
+            load_ply(path, indices);
+        } else if(path.ends_with(".glb")) {
+            load_glb(path, indices, triangle_keys);
+        } else if(path.ends_with(".stl")) {
+            load_stl(path, options, indices);
+        } else {
+            load_obj(path, indices, triangle_keys);
+        }
+
+        if(is_cancelled()) {
+            return;
+        }
+
+        if(options.remove_degenerate_triangles) {
+            remove_degenerate_triangles(_vertices, indices, triangle_keys, _statistics.degenerate_triangle_count, _statistics.duplicate_triangle_count);
+        }
+
+        const auto normal_start = std::chrono::steady_clock::now();
+
+        _statistics.generated_normal_count = generate_missing_normals(_vertices, indices);
+        _statistics.normal_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - normal_start).count();
+
+        const auto ranges = sort_triangles_by_key(indices, triangle_keys);
+        std::vector<uint64_t>().swap(triangle_keys);
+
+        const auto index_count = indices.size();
+        const auto vertex_count = _vertices.size();
+
+        if(full_quality) {
+            util::parallel_for(ranges.size(), 1, [&](size_t begin, size_t end) noexcept {
+                for(auto i = begin; i < end; i++) {
+                    auto* range_indices = indices.data() + ranges[i].index_offset;
+                    meshopt_optimizeVertexCache(range_indices, range_indices, ranges[i].index_count, vertex_count);
+                }
+            });
+        }
+
+        meshopt_optimizeVertexFetch(_vertices.data(), indices.data(), index_count, _vertices.data(), vertex_count, sizeof(vertex));
+
+        if(options.generate_tangents) {
+            const auto tangent_start = std::chrono::steady_clock::now();
+
+            _tangents = generate_tangents(_vertices, indices);
+            _statistics.tangent_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tangent_start).count();
+        }
+
+        _submeshes.resize(ranges.size());
+
+        util::parallel_for(ranges.size(), 1, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                const auto& range = ranges[i];
+                const auto* range_indices = indices.data() + range.index_offset;
+
+                auto& submesh = _submeshes[i];
+                submesh.material = range.material;
+                submesh.bounds_min = glm::vec3(std::numeric_limits<float>::max());
+                submesh.bounds_max = glm::vec3(-std::numeric_limits<float>::max());
+
+                for(uint32_t j = 0; j < range.index_count; j++) {
+                    const auto& position = _vertices[range_indices[j]].position;
+                    submesh.bounds_min = glm::min(submesh.bounds_min, position);
+                    submesh.bounds_max = glm::max(submesh.bounds_max, position);
+                }
+            }
+        });
+
+        _meshlet_parameters = options.meshlets;
+
+        if(is_cancelled()) {
+            return;
+        }
+
+        const auto tuning_path = std::string(path) + ".meshlet_tuning";
+        if(options.tune_meshlets && full_quality) {
+            const auto tuning_start = std::chrono::steady_clock::now();
+
+            std::vector<std::span<const uint32_t>> index_ranges;
+            for(const auto& range : ranges) {
+                index_ranges.emplace_back(indices.data() + range.index_offset, range.index_count);
+            }
+
+            const meshlet_tuner tuner(_vertices, index_ranges);
+            _meshlet_parameters = tuner.get_best().parameters;
+
+            meshlet_tuner::save(tuning_path, _meshlet_parameters);
+            _statistics.tuning_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tuning_start).count();
+        } else if(options.use_tuning_file) {
+            // a file tuned under a larger compiled layout is stale, the caller's parameters stand in for it
+            auto tuned_parameters = _meshlet_parameters;
+            if(meshlet_tuner::load(tuning_path, tuned_parameters) && tuned_parameters.max_vertices <= default_meshlet_config::max_vertices
+               && tuned_parameters.max_triangles <= default_meshlet_config::max_triangles) {
+                _meshlet_parameters = tuned_parameters;
+            }
+        }
+
+        if(!full_quality) {
+            _meshlet_parameters.clusterizer = meshlet_clusterizer::scan;
+        }
+
+        if(_meshlet_parameters.max_vertices > default_meshlet_config::max_vertices || _meshlet_parameters.max_triangles > default_meshlet_config::max_triangles) {
+            util::panic("mesh: meshlet parameters exceed the compiled meshlet layout");
+        }
+
+        if(is_cancelled()) {
+            return;
+        }
+
+        const auto build_start = std::chrono::steady_clock::now();
+
+        const auto chunks = partition_triangles(indices, ranges, _submeshes, _vertices, options.parallel_meshlet_build ? _MESHLET_CHUNK_TRIANGLES : 0);
+
+        std::vector<meshlet_build> builds(chunks.size());
+        std::vector<size_t> merged_counts(chunks.size(), 0);
+
+        util::parallel_for(chunks.size(), 1, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                build_meshlets(_meshlet_parameters, indices.data() + chunks[i].index_offset, chunks[i].index_count, _vertices, builds[i]);
+
+                if(options.merge_small_meshlets && full_quality) {
+                    merged_counts[i] = merge_meshlets(_meshlet_parameters, _vertices, builds[i]);
+                }
+            }
+        });
+
+        _statistics.meshlet_chunk_count = chunks.size();
+        _statistics.merged_meshlet_count = std::accumulate(merged_counts.begin(), merged_counts.end(), size_t(0));
+        _statistics.meshlet_build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+
+        // chunks are ordered by submesh, so the concatenated meshlets of one submesh stay contiguous
+        size_t meshlet_offset = 0;
+        for(size_t i = 0; i < chunks.size(); i++) {
+            auto& submesh = _submeshes[chunks[i].range];
+            if(i == 0 || chunks[i - 1].range != chunks[i].range) {
+                submesh.meshlet_offset = static_cast<uint32_t>(meshlet_offset);
+                submesh.meshlet_count = 0;
+            }
+
+            submesh.meshlet_count += static_cast<uint32_t>(builds[i].meshlets.size());
+            meshlet_offset += builds[i].meshlets.size();
+        }
+
+        pack_meshlets(builds, _meshlets, _meshlet_data);
+        align_submesh_meshlets(_submeshes, _meshlets);
+
+        size_t triangle_count = 0;
+        for(const auto& meshlet : _meshlets) {
+            triangle_count += meshlet.triangle_count;
+        }
+
+        _statistics.meshlet_fill_ratio = meshlet_offset > 0 ? static_cast<double>(triangle_count) / static_cast<double>(meshlet_offset * _meshlet_parameters.max_triangles) : 0.0;
+
+        if(is_cancelled()) {
+            return;
+        }
+
+        const auto bounds_start = std::chrono::steady_clock::now();
+
+        compute_meshlet_bounds(_meshlets, _meshlet_data, _vertices, _meshlet_bounds);
+        _statistics.bounds_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - bounds_start).count();
+
+        // grouping moves meshlets, so it goes before optimize_meshlets numbers the vertices in meshlet order
+        const auto grouping_start = std::chrono::steady_clock::now();
+
+        if(options.group_meshlets) {
+            sort_meshlets_spatially(_submeshes, _meshlets, _meshlet_data, _meshlet_bounds);
+        }
+
+        compute_meshlet_group_bounds(_meshlets, _meshlet_bounds, _meshlet_group_bounds);
+        _statistics.grouping_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - grouping_start).count();
+
+        const auto bvh_start = std::chrono::steady_clock::now();
+
+        build_meshlet_bvh(_meshlets, _meshlet_bounds, _meshlet_bvh);
+        _statistics.bvh_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - bvh_start).count();
+
+        if(is_cancelled()) {
+            return;
+        }
+
+        if(options.optimize_meshlets && full_quality) {
+            const auto optimize_start = std::chrono::steady_clock::now();
+
+            optimize_meshlets(_meshlets, _meshlet_data, _vertices, _tangents);
+            _statistics.meshlet_optimize_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - optimize_start).count();
+        }
+
+        // after optimize_meshlets, which renumbers the vertices level 0 is copied with
+        if(is_cancelled()) {
+            return;
+        }
+
+        if(options.build_cluster_lod && full_quality) {
+            const auto lod_start = std::chrono::steady_clock::now();
+
+            build_lod_meshlets(_meshlet_parameters, _vertices, _meshlets, _meshlet_data, options.optimize_meshlets, _submeshes, _lod_meshlets, _lod_meshlet_data,
+                               _lod_clusters);
+
+            for(const auto& cluster : _lod_clusters) {
+                _statistics.cluster_lod_level_count = std::max<size_t>(_statistics.cluster_lod_level_count, cluster.level + 1);
+            }
+
+            _statistics.cluster_lod_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lod_start).count();
+        }
+
+        if(is_cancelled()) {
+            return;
+        }
+
+        if(options.lod_level_count > 0 && full_quality) {
+            const auto chain_start = std::chrono::steady_clock::now();
+
+            build_lod_levels(_meshlet_parameters, _vertices, _meshlets, _meshlet_data, _submeshes, options.lod_level_count, options.optimize_meshlets, _lod_levels);
+            _statistics.lod_chain_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - chain_start).count();
+        }
+
+        if(is_cancelled()) {
+            return;
+        }
+
+        if(options.build_shadow_meshlets && full_quality) {
+            const auto shadow_start = std::chrono::steady_clock::now();
+
+            build_shadow_meshlets(_meshlet_parameters, options, _vertices, _meshlets, _meshlet_data, _shadow_positions, _shadow_meshlets, _shadow_meshlet_data,
+                                  _shadow_meshlet_bounds);
+            _statistics.shadow_meshlet_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - shadow_start).count();
+        }
+
+        const auto scratch_statistics = scratch_scope.get_statistics();
+        _statistics.scratch_allocation_count = scratch_statistics.allocation_count;
+        _statistics.scratch_peak_bytes = scratch_statistics.peak_bytes;
+        _statistics.total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
@@ -1,13 +1,20 @@
 #pragma once
 
+#include "meshlet_config.hpp"
+
 #include <glm/glm.hpp>
 
+#include <atomic>
 #include <string_view>
 #include <vector>
 
 namespace d3d12_mesh_shaders {
     class mesh final {
     public:
+        // meshlets per amplification thread group; every submesh starts a group of its own in get_meshlets(), and the
+        // tail of its last group is padded with empty meshlets
+        static const uint32_t MESHLET_GROUP_SIZE = 32;
+
         struct vertex final {
             glm::vec3 position;
             glm::vec2 tex_coord;
@@ -27,13 +34,220 @@ namespace d3d12_mesh_shaders {
             meshlet(uint32_t data_offset, uint32_t vertex_count, uint32_t triangle_count) noexcept
                 : data_offset(data_offset), vertex_count(vertex_count), triangle_count(triangle_count) {}
         };
+
+        // One per meshlet, 32 bytes so two share a cache line. A meshlet is backfacing for a camera at c when
+        // dot(normalize(cone_apex - c), cone_axis / 127) >= cone_cutoff / 127; the 8 bit cutoff is rounded conservatively.
+        struct meshlet_bounds final {
+            glm::vec3 center;
+            float radius;
+            glm::vec3 cone_apex;
+            int8_t cone_axis[3];
+            int8_t cone_cutoff;
+        };
+
+        static_assert(sizeof(meshlet_bounds) == 32);
+
+        // One per MESHLET_GROUP_SIZE meshlets: a sphere around the meshlet spheres and a normal cone around the meshlet cones,
+        // so a whole group can be rejected before its meshlets are tested. All of the group is backfacing for a camera at c
+        // when dot(center - c, cone_axis) >= cone_cutoff * length(center - c) + radius; a cutoff of 1 never rejects.
+        struct meshlet_group_bounds final {
+            glm::vec3 center;
+            float radius;
+            glm::vec3 cone_axis;
+            float cone_cutoff;
+        };
+
+        static_assert(sizeof(meshlet_group_bounds) == 32);
+
+        // Node of the 4-wide meshlet BVH, see build_meshlet_bvh. The child boxes are stored component by component so four can
+        // be tested at once. A child with a meshlet count is a leaf holding that many meshlets from children[i] on, one
+        // group; without, children[i] is a node index, or ~0u for an unused slot whose box is empty.
+        struct alignas(64) meshlet_bvh_node final {
+            float min_x[4];
+            float min_y[4];
+            float min_z[4];
+            float max_x[4];
+            float max_y[4];
+            float max_z[4];
+            uint32_t children[4];
+            uint32_t meshlet_counts[4];
+        };
+
+        static_assert(sizeof(meshlet_bvh_node) == 128);
+
+        // One per meshlet of the cluster LOD DAG, see build_cluster_lod. error is the object space error the cluster was
+        // simplified with and parent_error the one of the clusters it was simplified into, each with the sphere it is
+        // projected from. Both only grow towards the roots, whose parent_error is FLT_MAX, so for a view exactly one cluster
+        // of every path through the DAG projects its error to at most a threshold and its parent error to more: the cut.
+        struct lod_cluster final {
+            glm::vec3 center;
+            float radius;
+            glm::vec3 parent_center;
+            float parent_radius;
+            float error;
+            float parent_error;
+            uint32_t level;
+        };
+
+        // Meshlets of one submesh are contiguous in get_meshlets() and start on a group boundary, and submeshes sharing a
+        // material are adjacent. The same holds for get_lod_meshlets(), which is only padded at its end.
+        struct submesh final {
+            uint32_t meshlet_offset;
+            uint32_t meshlet_count;
+            uint32_t lod_meshlet_offset;
+            uint32_t lod_meshlet_count;
+            uint32_t material;
+            glm::vec3 bounds_min;
+            glm::vec3 bounds_max;
+        };
+
+        // One coarser copy of the whole mesh in the discrete LOD chain, with meshlets laid out like get_meshlets() but only
+        // padded at the end, and bounds parallel to them. submeshes has the meshlet ranges of the level. error is the object
+        // space error summed down the chain, so it grows from level to level.
+        struct lod_level final {
+            std::vector<meshlet> meshlets;
+            std::vector<uint32_t> meshlet_data;
+            std::vector<meshlet_bounds> bounds;
+            std::vector<submesh> submeshes;
+            float error;
+            size_t triangle_count;
+        };
+
+        // greedy is meshopt_buildMeshlets, graph is build_graph_meshlets and scan is meshopt_buildMeshletsScan, which only
+        // cuts the index buffer into meshlets in order
+        enum class meshlet_clusterizer : uint32_t {
+            greedy,
+            graph,
+            scan
+        };
+
+        // preview cooks for a first frame as soon as possible: the vertex cache pass is skipped, meshlets come from the scan
+        // clusterizer and none of the optional passes of build_options run; full runs everything asked for
+        enum class build_quality : uint32_t {
+            preview,
+            full
+        };
+
+        // Runtime meshlet limits. They must name one of the meshlet_config layouts and fit default_meshlet_config, the
+        // layout the shaders are compiled for. cone_weight only affects the greedy clusterizer.
+        struct meshlet_parameters final {
+            uint32_t max_vertices = default_meshlet_config::max_vertices;
+            uint32_t max_triangles = default_meshlet_config::max_triangles;
+            float cone_weight = 0.0f;
+            meshlet_clusterizer clusterizer = meshlet_clusterizer::greedy;
+        };
+
+        struct build_options final {
+            build_quality quality = build_quality::full;
+
+            // STL only: welding distance relative to the largest bounding box extent, and the angle in degrees up to which
+            // adjacent facets are smoothed together (0 gives flat shading)
+            float weld_tolerance = 1e-5f;
+            float crease_angle = 30.0f;
+
+            // drop zero-area and repeated triangles before they take up meshlet slots
+            bool remove_degenerate_triangles = true;
+
+            // fill get_tangents() with one packed MikkTSpace-style frame per vertex, see generate_tangents
+            bool generate_tangents = false;
+
+            // split large submeshes into spatial chunks and build their meshlets on all cores, at a small cost in meshlet count
+            bool parallel_meshlet_build = true;
+
+            // fold nearly empty meshlets into their neighbours, see merge_meshlets
+            bool merge_small_meshlets = true;
+
+            // order the meshlets of each submesh along a Morton curve, so every group of MESHLET_GROUP_SIZE is compact
+            bool group_meshlets = true;
+
+            // reorder each meshlet with optimize_meshlet and the vertex buffer in meshlet order, so the vertex indices in the
+            // meshlet data are near-sequential
+            bool optimize_meshlets = true;
+
+            // fill get_lod_meshlets() with the cluster LOD DAG, see build_cluster_lod
+            bool build_cluster_lod = false;
+
+            // coarser levels of the discrete LOD chain in get_lod_levels(), each simplified to half the triangles of the last
+            uint32_t lod_level_count = 0;
+
+            // fill get_shadow_meshlets() with a position-only meshlet set for depth and shadow passes, see
+            // build_shadow_meshlets
+            bool build_shadow_meshlets = false;
+
+            // With use_tuning_file, a tuning file (the asset path plus ".meshlet_tuning") next to the asset replaces meshlets,
+            // unless it no longer fits the compiled meshlet layout; callers passing explicit parameters clear it. With
+            // tune_meshlets the parameter grid is searched instead and the winner is written to that file.
+            meshlet_parameters meshlets {};
+            bool use_tuning_file = true;
+            bool tune_meshlets = false;
+
+            // Polled between passes; once it reads true the build stops at the next pass and the mesh is left half built,
+            // fit only to be thrown away. A background build uses it so that shutdown need not wait for the whole build.
+            const std::atomic<bool>* cancel = nullptr;
+        };
+
+        struct statistics final {
+            // the whole build, from opening the asset to the last pass
+            double total_seconds;
+            size_t source_bytes;
+            double parse_seconds;
+            double weld_seconds;
+            size_t degenerate_triangle_count;
+            size_t duplicate_triangle_count;
+            size_t generated_normal_count;
+            double normal_seconds;
+            double tangent_seconds;
+            double tuning_seconds;
+            size_t meshlet_chunk_count;
+            double meshlet_build_seconds;
+            size_t merged_meshlet_count;
+            // average triangle count over max_triangles, padding excluded
+            double meshlet_fill_ratio;
+            double meshlet_optimize_seconds;
+            double bounds_seconds;
+            double grouping_seconds;
+            double bvh_seconds;
+            size_t cluster_lod_level_count;
+            double cluster_lod_seconds;
+            double lod_chain_seconds;
+            double shadow_meshlet_seconds;
+            // meshoptimizer scratch served by scratch_arena during the build
+            size_t scratch_allocation_count;
+            size_t scratch_peak_bytes;
+
+            [[nodiscard]] inline double get_parse_throughput() const noexcept {
+                return parse_seconds > 0.0 ? static_cast<double>(source_bytes) / (1024.0 * 1024.0) / parse_seconds : 0.0;
+            }
+        };
     private:
         std::vector<vertex> _vertices;
         std::vector<meshlet> _meshlets;
         std::vector<uint32_t> _meshlet_data;
+        std::vector<meshlet_bounds> _meshlet_bounds;
+        std::vector<meshlet_group_bounds> _meshlet_group_bounds;
+        std::vector<meshlet_bvh_node> _meshlet_bvh;
+        std::vector<meshlet> _lod_meshlets;
+        std::vector<uint32_t> _lod_meshlet_data;
+        std::vector<lod_cluster> _lod_clusters;
+        std::vector<lod_level> _lod_levels;
+        std::vector<glm::vec3> _shadow_positions;
+        std::vector<meshlet> _shadow_meshlets;
+        std::vector<uint32_t> _shadow_meshlet_data;
+        std::vector<meshlet_bounds> _shadow_meshlet_bounds;
+        std::vector<submesh> _submeshes;
+        std::vector<uint32_t> _tangents;
+
+        meshlet_parameters _meshlet_parameters {};
 
+        statistics _statistics {};
+
+        void load_obj(const std::string_view& path, std::vector<uint32_t>& indices, std::vector<uint64_t>& triangle_keys) noexcept;
+        void load_ply(const std::string_view& path, std::vector<uint32_t>& indices) noexcept;
+        void load_glb(const std::string_view& path, std::vector<uint32_t>& indices, std::vector<uint64_t>& triangle_keys) noexcept;
+        void load_stl(const std::string_view& path, const build_options& options, std::vector<uint32_t>& indices) noexcept;
     public:
         mesh(const std::string_view& path) noexcept;
+        mesh(const std::string_view& path, const build_options& options) noexcept;
 
         [[nodiscard]] inline const std::vector<vertex>& get_vertices() const noexcept {
             return _vertices;
@@ -46,5 +260,79 @@ namespace d3d12_mesh_shaders {
         [[nodiscard]] inline const std::vector<uint32_t>& get_meshlet_data() const noexcept {
             return _meshlet_data;
         }
+
+        // parallel to get_meshlets(), padding meshlets get zero bounds
+        [[nodiscard]] inline const std::vector<meshlet_bounds>& get_meshlet_bounds() const noexcept {
+            return _meshlet_bounds;
+        }
+
+        // one per MESHLET_GROUP_SIZE entries of get_meshlets()
+        [[nodiscard]] inline const std::vector<meshlet_group_bounds>& get_meshlet_group_bounds() const noexcept {
+            return _meshlet_group_bounds;
+        }
+
+        // root first, empty when there are no meshlets
+        [[nodiscard]] inline const std::vector<meshlet_bvh_node>& get_meshlet_bvh() const noexcept {
+            return _meshlet_bvh;
+        }
+
+        // Same layout as get_meshlets() but only padded at the end, empty unless build_options::build_cluster_lod was set. Level
+        // 0 of every submesh is a copy of its meshlets.
+        [[nodiscard]] inline const std::vector<meshlet>& get_lod_meshlets() const noexcept {
+            return _lod_meshlets;
+        }
+
+        [[nodiscard]] inline const std::vector<uint32_t>& get_lod_meshlet_data() const noexcept {
+            return _lod_meshlet_data;
+        }
+
+        // parallel to get_lod_meshlets(), padding meshlets get zero errors and are never selected
+        [[nodiscard]] inline const std::vector<lod_cluster>& get_lod_clusters() const noexcept {
+            return _lod_clusters;
+        }
+
+        // the discrete LOD chain below the mesh itself, coarsest last; may stop short of build_options::lod_level_count once
+        // the mesh no longer simplifies
+        [[nodiscard]] inline const std::vector<lod_level>& get_lod_levels() const noexcept {
+            return _lod_levels;
+        }
+
+        // Compact position stream of the shadow meshlets, one entry per distinct position of the mesh; empty unless
+        // build_options::build_shadow_meshlets was set.
+        [[nodiscard]] inline const std::vector<glm::vec3>& get_shadow_positions() const noexcept {
+            return _shadow_positions;
+        }
+
+        // Same layout as get_meshlets() and padded the same way, but over the whole mesh with materials ignored and with
+        // vertex indices into get_shadow_positions(). Only fit for passes that read nothing but positions.
+        [[nodiscard]] inline const std::vector<meshlet>& get_shadow_meshlets() const noexcept {
+            return _shadow_meshlets;
+        }
+
+        [[nodiscard]] inline const std::vector<uint32_t>& get_shadow_meshlet_data() const noexcept {
+            return _shadow_meshlet_data;
+        }
+
+        // parallel to get_shadow_meshlets(), padding meshlets get zero bounds
+        [[nodiscard]] inline const std::vector<meshlet_bounds>& get_shadow_meshlet_bounds() const noexcept {
+            return _shadow_meshlet_bounds;
+        }
+
+        // parallel to get_vertices(), empty unless build_options::generate_tangents was set
+        [[nodiscard]] inline const std::vector<uint32_t>& get_tangents() const noexcept {
+            return _tangents;
+        }
+
+        [[nodiscard]] inline const std::vector<submesh>& get_submeshes() const noexcept {
+            return _submeshes;
+        }
+
+        [[nodiscard]] inline const meshlet_parameters& get_meshlet_parameters() const noexcept {
+            return _meshlet_parameters;
+        }
+
+        [[nodiscard]] inline const statistics& get_statistics() const noexcept {
+            return _statistics;
+        }
     };
 }
\ No newline at end of file
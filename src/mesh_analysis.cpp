@@ -0,0 +1,539 @@
+#include "mesh_analysis.hpp"
+#include "cluster_lod.hpp"
+#include "lod_selector.hpp"
+#include "meshlet_culler.hpp"
+#include "util.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <utility>
+
+namespace d3d12_mesh_shaders {
+    static const double _CONE_ANGLE_BIN_DEGREES = 15.0;
+
+    static inline size_t get_fill_bin(uint32_t count, uint32_t limit) noexcept {
+        return std::min<size_t>(static_cast<size_t>(count) * mesh_analysis::FILL_BINS / limit, mesh_analysis::FILL_BINS - 1);
+    }
+
+    // culling views sit on the 26 directions of a 3x3x3 grid around the bounds center, at these multiples of the bounds
+    // radius, and look at the center
+    static const std::array<float, 2> _CULLING_VIEW_DISTANCES = { 0.75f, 2.0f };
+    static const float _CULLING_FIELD_OF_VIEW = 60.0f;
+
+    // the LOD cuts are taken from the same directions at these multiples of the bounds radius, for errors of this many pixels
+    static const std::array<float, mesh_analysis::LOD_VIEW_DISTANCES> _LOD_VIEW_DISTANCES = { 2.0f, 8.0f, 32.0f };
+    static const std::array<float, mesh_analysis::LOD_ERROR_THRESHOLDS> _LOD_ERROR_THRESHOLDS = { 0.25f, 0.5f, 1.0f, 2.0f, 4.0f, 8.0f };
+    static const float _LOD_VIEWPORT_HEIGHT = 1080.0f;
+    static const float _LOD_CHAIN_ERROR_THRESHOLD = 1.0f;
+
+    static mesh_analysis::distribution get_distribution(std::vector<double>& values) noexcept {
+        if(values.empty()) {
+            return mesh_analysis::distribution {};
+        }
+
+        std::sort(values.begin(), values.end());
+
+        double sum = 0.0;
+        for(const auto value : values) {
+            sum += value;
+        }
+
+        const auto percentile = [&](double p) noexcept {
+            return values[std::min(static_cast<size_t>(p * static_cast<double>(values.size())), values.size() - 1)];
+        };
+
+        return mesh_analysis::distribution {
+            .min = values.front(),
+            .max = values.back(),
+            .mean = sum / static_cast<double>(values.size()),
+            .p50 = percentile(0.5),
+            .p90 = percentile(0.9),
+            .p99 = percentile(0.99)
+        };
+    }
+
+    static mesh_analysis::culling measure_culling(const mesh& mesh, const glm::vec3& min, const glm::vec3& max) noexcept {
+        mesh_analysis::culling result {};
+
+        const auto center = (min + max) * 0.5f;
+        const auto radius = std::max(glm::length(max - min) * 0.5f, 1e-6f);
+
+        std::vector<uint32_t> visible_meshlets;
+        std::vector<uint32_t> flat_visible_meshlets;
+
+        for(int x = -1; x <= 1; x++) {
+            for(int y = -1; y <= 1; y++) {
+                for(int z = -1; z <= 1; z++) {
+                    if(x == 0 && y == 0 && z == 0) {
+                        continue;
+                    }
+
+                    const auto direction = glm::normalize(glm::vec3(x, y, z));
+                    const auto up = x == 0 && z == 0 ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+                    for(const auto distance : _CULLING_VIEW_DISTANCES) {
+                        const auto position = center + direction * radius * distance;
+                        const auto projection = util::reverse_depth_projection_matrix_lh(_CULLING_FIELD_OF_VIEW, 1.0f, radius * 1e-3f, radius * (distance + 2.0f));
+                        const meshlet_culler culler(projection * glm::lookAt(position, center, up), position);
+
+                        const auto flat = culler.cull(mesh, false, flat_visible_meshlets);
+                        const auto grouped = culler.cull(mesh, true, visible_meshlets);
+                        const auto bvh = culler.cull(mesh.get_meshlet_bvh(), mesh.get_meshlet_bounds(), visible_meshlets);
+
+                        // the BVH only changes how many tests it takes to find the visible set, never the set itself
+                        std::sort(flat_visible_meshlets.begin(), flat_visible_meshlets.end());
+                        std::sort(visible_meshlets.begin(), visible_meshlets.end());
+                        if(visible_meshlets != flat_visible_meshlets) {
+                            util::panic("mesh_analysis: the meshlet BVH query and the flat scan disagree");
+                        }
+
+                        result.view_count++;
+                        result.flat_meshlet_tests += flat.meshlet_tests;
+                        result.flat_visible_meshlet_count += flat.visible_meshlet_count;
+                        result.group_tests += grouped.group_tests;
+                        result.grouped_meshlet_tests += grouped.meshlet_tests;
+                        result.grouped_visible_meshlet_count += grouped.visible_meshlet_count;
+                        result.bvh_box_tests += bvh.node_tests;
+                        result.bvh_meshlet_tests += bvh.meshlet_tests;
+                        result.bvh_visible_meshlet_count += bvh.visible_meshlet_count;
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+    static mesh_analysis::cluster_lod measure_cluster_lod(const mesh& mesh, const glm::vec3& min, const glm::vec3& max) noexcept {
+        mesh_analysis::cluster_lod result {};
+
+        const auto& clusters = mesh.get_lod_clusters();
+        if(clusters.empty()) {
+            return result;
+        }
+
+        result.level_count = mesh.get_statistics().cluster_lod_level_count;
+        for(const auto& submesh : mesh.get_submeshes()) {
+            result.cluster_count += submesh.lod_meshlet_count;
+        }
+
+        const auto center = (min + max) * 0.5f;
+        const auto radius = std::max(glm::length(max - min) * 0.5f, 1e-6f);
+        const auto projection_scale = _LOD_VIEWPORT_HEIGHT / (2.0f * glm::tan(glm::radians(_CULLING_FIELD_OF_VIEW) * 0.5f));
+
+        std::vector<uint32_t> selected_clusters;
+        size_t view_count = 0;
+
+        for(int x = -1; x <= 1; x++) {
+            for(int y = -1; y <= 1; y++) {
+                for(int z = -1; z <= 1; z++) {
+                    if(x == 0 && y == 0 && z == 0) {
+                        continue;
+                    }
+
+                    const auto direction = glm::normalize(glm::vec3(x, y, z));
+                    view_count++;
+
+                    for(size_t i = 0; i < mesh_analysis::LOD_VIEW_DISTANCES; i++) {
+                        const auto position = center + direction * radius * _LOD_VIEW_DISTANCES[i];
+
+                        for(size_t j = 0; j < mesh_analysis::LOD_ERROR_THRESHOLDS; j++) {
+                            selected_clusters.clear();
+                            result.cut_triangle_counts[i][j] += static_cast<double>(select_lod_clusters(clusters, mesh.get_lod_meshlets(), position, projection_scale,
+                                                                                                        _LOD_ERROR_THRESHOLDS[j], selected_clusters));
+                        }
+                    }
+                }
+            }
+        }
+
+        for(auto& counts : result.cut_triangle_counts) {
+            for(auto& count : counts) {
+                count /= static_cast<double>(view_count);
+            }
+        }
+
+        return result;
+    }
+
+    static mesh_analysis::lod_chain measure_lod_chain(const mesh& mesh, size_t triangle_count, const glm::vec3& min, const glm::vec3& max) noexcept {
+        mesh_analysis::lod_chain result {};
+
+        for(const auto& level : mesh.get_lod_levels()) {
+            size_t meshlet_count = 0;
+            for(const auto& submesh : level.submeshes) {
+                meshlet_count += submesh.meshlet_count;
+            }
+
+            result.level_triangle_counts.push_back(level.triangle_count);
+            result.level_meshlet_counts.push_back(meshlet_count);
+            result.level_errors.push_back(level.error);
+        }
+
+        const auto center = (min + max) * 0.5f;
+        const auto radius = std::max(glm::length(max - min) * 0.5f, 1e-6f);
+        const auto projection_scale = _LOD_VIEWPORT_HEIGHT / (2.0f * glm::tan(glm::radians(_CULLING_FIELD_OF_VIEW) * 0.5f));
+
+        // the selector only sees the distance to the bounds, so one direction stands for all
+        for(size_t i = 0; i < mesh_analysis::LOD_VIEW_DISTANCES; i++) {
+            const lod_selector selector(center + glm::vec3(0.0f, 0.0f, radius * _LOD_VIEW_DISTANCES[i]), projection_scale, _LOD_CHAIN_ERROR_THRESHOLD);
+
+            const auto level = selector.select(mesh, glm::mat4(1.0f));
+            result.selected_triangle_counts[i] = level == 0 ? triangle_count : mesh.get_lod_levels()[level - 1].triangle_count;
+        }
+
+        return result;
+    }
+
+    static mesh_analysis::shadow_meshlets measure_shadow_meshlets(const mesh& mesh) noexcept {
+        mesh_analysis::shadow_meshlets result {};
+
+        const auto& positions = mesh.get_shadow_positions();
+        const auto& meshlets = mesh.get_shadow_meshlets();
+        const auto& meshlet_data = mesh.get_shadow_meshlet_data();
+
+        std::vector<uint32_t> indices;
+
+        for(const auto& meshlet : meshlets) {
+            if(meshlet.triangle_count == 0) {
+                continue;
+            }
+
+            result.meshlet_count++;
+
+            const auto* vertex_indices = meshlet_data.data() + meshlet.data_offset;
+            const auto* packed_indices = reinterpret_cast<const uint8_t*>(vertex_indices + meshlet.vertex_count);
+
+            for(uint32_t i = 0; i < meshlet.triangle_count * 3; i++) {
+                indices.push_back(vertex_indices[packed_indices[i]]);
+            }
+        }
+
+        result.position_count = positions.size();
+        result.position_bytes = positions.size() * sizeof(glm::vec3);
+        result.meshlet_data_bytes = meshlet_data.size() * sizeof(uint32_t);
+        result.meshlet_header_bytes = meshlets.size() * (sizeof(mesh::meshlet) + sizeof(mesh::meshlet_bounds));
+        result.bytes_fetched = positions.empty() ? 0 : meshopt_analyzeVertexFetch(indices.data(), indices.size(), positions.size(), sizeof(glm::vec3)).bytes_fetched;
+
+        return result;
+    }
+
+    mesh_analysis::mesh_analysis(const mesh& mesh) noexcept : _parameters(mesh.get_meshlet_parameters()) {
+        const auto& vertices = mesh.get_vertices();
+        const auto& meshlets = mesh.get_meshlets();
+        const auto& meshlet_data = mesh.get_meshlet_data();
+        const auto& meshlet_bounds = mesh.get_meshlet_bounds();
+
+        _meshlet_count = 0;
+        _vertex_count = vertices.size();
+        _triangle_count = 0;
+        _cullable_count = 0;
+
+        auto min = glm::vec3(std::numeric_limits<float>::max()), max = glm::vec3(-std::numeric_limits<float>::max());
+        for(const auto& vertex : vertices) {
+            min = glm::min(min, vertex.position);
+            max = glm::max(max, vertex.position);
+        }
+
+        const auto extent = vertices.empty() ? 1.0 : std::max(static_cast<double>(glm::max(max.x - min.x, glm::max(max.y - min.y, max.z - min.z))), 1e-30);
+
+        std::vector<uint8_t> referenced(vertices.size(), 0);
+        std::vector<uint32_t> indices, references;
+        std::vector<double> radii, relative_radii;
+
+        size_t vertex_references = 0;
+
+        for(size_t i = 0; i < meshlets.size(); i++) {
+            const auto& meshlet = meshlets[i];
+
+            // padding meshlets
+            if(meshlet.triangle_count == 0) {
+                continue;
+            }
+
+            _meshlet_count++;
+            _triangle_count += meshlet.triangle_count;
+            vertex_references += meshlet.vertex_count;
+
+            _vertex_fill_histogram[get_fill_bin(meshlet.vertex_count, _parameters.max_vertices)]++;
+            _triangle_fill_histogram[get_fill_bin(meshlet.triangle_count, _parameters.max_triangles)]++;
+
+            const auto* vertex_indices = meshlet_data.data() + meshlet.data_offset;
+            const auto* packed_indices = reinterpret_cast<const uint8_t*>(vertex_indices + meshlet.vertex_count);
+
+            for(uint32_t j = 0; j < meshlet.vertex_count; j++) {
+                referenced[vertex_indices[j]] = 1;
+                references.push_back(vertex_indices[j]);
+            }
+
+            for(uint32_t j = 0; j < meshlet.triangle_count * 3; j++) {
+                indices.push_back(vertex_indices[packed_indices[j]]);
+            }
+
+            const auto& bounds = meshlet_bounds[i];
+            radii.push_back(bounds.radius);
+            relative_radii.push_back(bounds.radius / extent);
+
+            // a cutoff of 127 encodes a cone that contains every direction, meshopt's stand-in for "never backfacing"
+            if(bounds.cone_cutoff < 127) {
+                _cullable_count++;
+
+                const auto angle = 2.0 * std::asin(std::clamp(bounds.cone_cutoff / 127.0, -1.0, 1.0)) * 180.0 / 3.14159265358979323846;
+                _cone_angle_histogram[std::min(static_cast<size_t>(angle / _CONE_ANGLE_BIN_DEGREES), CONE_ANGLE_BINS - 1)]++;
+            }
+        }
+
+        _fill_ratio = _meshlet_count > 0 ? static_cast<double>(_triangle_count) / static_cast<double>(_meshlet_count * _parameters.max_triangles) : 0.0;
+        _merged_meshlet_count = mesh.get_statistics().merged_meshlet_count;
+
+        const auto referenced_count = std::max<size_t>(std::count(referenced.begin(), referenced.end(), 1), 1);
+        _vertex_duplication = static_cast<double>(vertex_references) / static_cast<double>(referenced_count);
+
+        _radius = get_distribution(radii);
+        _relative_radius = get_distribution(relative_radii);
+
+        std::vector<double> group_relative_radii;
+        for(const auto& group : mesh.get_meshlet_group_bounds()) {
+            group_relative_radii.push_back(group.radius / extent);
+        }
+
+        _group_relative_radius = get_distribution(group_relative_radii);
+        _culling = measure_culling(mesh, min, max);
+        _cluster_lod = measure_cluster_lod(mesh, min, max);
+        _lod_chain = measure_lod_chain(mesh, _triangle_count, min, max);
+
+        _vertex_fetch = vertices.empty() ? meshopt_VertexFetchStatistics {}
+                                         : meshopt_analyzeVertexFetch(indices.data(), indices.size(), vertices.size(), sizeof(mesh::vertex));
+
+        std::vector<uint8_t> encoded(std::max(meshopt_encodeIndexSequenceBound(references.size(), vertices.size()),
+                                              meshopt_encodeVertexBufferBound(meshlet_data.size(), sizeof(uint32_t))));
+
+        _meshlet_data_bytes = meshlet_data.size() * sizeof(uint32_t);
+        _encoded_reference_bytes = meshopt_encodeIndexSequence(encoded.data(), encoded.size(), references.data(), references.size());
+        _encoded_meshlet_data_bytes = meshopt_encodeVertexBuffer(encoded.data(), encoded.size(), meshlet_data.data(), meshlet_data.size(), sizeof(uint32_t));
+
+        _shadow_meshlets = measure_shadow_meshlets(mesh);
+        _shadow_meshlets.main_bytes = _vertex_count * sizeof(mesh::vertex) + _meshlet_data_bytes + meshlets.size() * (sizeof(mesh::meshlet) + sizeof(mesh::meshlet_bounds));
+    }
+
+    // Minimal writer for the report's fixed shape; numbers go through to_chars so the output doesn't depend on the locale.
+    class json_writer final {
+    private:
+        std::string _result;
+        bool _first = true;
+
+        inline void separate() noexcept {
+            if(!_first) {
+                _result += ',';
+            }
+
+            _first = false;
+        }
+    public:
+        inline void key(const char* name) noexcept {
+            separate();
+            _result += '"';
+            _result += name;
+            _result += "\":";
+            _first = true;
+        }
+
+        // only for the report's own identifiers, nothing is escaped
+        inline void string(const char* value) noexcept {
+            separate();
+            _result += '"';
+            _result += value;
+            _result += '"';
+        }
+
+        inline void begin(char bracket) noexcept {
+            separate();
+            _result += bracket;
+            _first = true;
+        }
+
+        inline void end(char bracket) noexcept {
+            _result += bracket;
+            _first = false;
+        }
+
+        template<typename T>
+        inline void value(T value) noexcept {
+            separate();
+
+            char buffer[32];
+            const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            _result.append(buffer, result.ptr);
+        }
+
+        template<typename T>
+        inline void field(const char* name, T value) noexcept {
+            key(name);
+            this->value(value);
+        }
+
+        template<typename T, size_t N>
+        inline void field(const char* name, const std::array<T, N>& values) noexcept {
+            key(name);
+            begin('[');
+            for(const auto value : values) {
+                this->value(value);
+            }
+            end(']');
+        }
+
+        template<typename T>
+        inline void field(const char* name, const std::vector<T>& values) noexcept {
+            key(name);
+            begin('[');
+            for(const auto value : values) {
+                this->value(value);
+            }
+            end(']');
+        }
+
+        inline void field(const char* name, const mesh_analysis::distribution& distribution) noexcept {
+            key(name);
+            begin('{');
+            field("min", distribution.min);
+            field("max", distribution.max);
+            field("mean", distribution.mean);
+            field("p50", distribution.p50);
+            field("p90", distribution.p90);
+            field("p99", distribution.p99);
+            end('}');
+        }
+
+        [[nodiscard]] inline std::string& get_result() noexcept {
+            return _result;
+        }
+    };
+
+    std::string mesh_analysis::to_json() const noexcept {
+        json_writer writer;
+        writer.begin('{');
+
+        writer.field("meshlet_count", _meshlet_count);
+        writer.field("vertex_count", _vertex_count);
+        writer.field("triangle_count", _triangle_count);
+
+        writer.key("limits");
+        writer.begin('{');
+        writer.field("max_vertices", _parameters.max_vertices);
+        writer.field("max_triangles", _parameters.max_triangles);
+        writer.field("cone_weight", _parameters.cone_weight);
+        writer.end('}');
+
+        writer.key("clusterizer");
+        switch(_parameters.clusterizer) {
+            case mesh::meshlet_clusterizer::greedy:
+                writer.string("greedy");
+                break;
+            case mesh::meshlet_clusterizer::graph:
+                writer.string("graph");
+                break;
+            case mesh::meshlet_clusterizer::scan:
+                writer.string("scan");
+                break;
+        }
+
+        writer.field("vertex_fill_histogram", _vertex_fill_histogram);
+        writer.field("triangle_fill_histogram", _triangle_fill_histogram);
+        writer.field("fill_ratio", _fill_ratio);
+        writer.field("merged_meshlet_count", _merged_meshlet_count);
+        writer.field("vertex_duplication", _vertex_duplication);
+
+        writer.field("radius", _radius);
+        writer.field("relative_radius", _relative_radius);
+
+        writer.field("cullable_count", _cullable_count);
+        writer.field("cone_angle_bin_degrees", _CONE_ANGLE_BIN_DEGREES);
+        writer.field("cone_angle_histogram", _cone_angle_histogram);
+
+        writer.field("group_relative_radius", _group_relative_radius);
+
+        writer.key("culling");
+        writer.begin('{');
+        writer.field("view_count", _culling.view_count);
+        writer.field("flat_meshlet_tests", _culling.flat_meshlet_tests);
+        writer.field("flat_visible_meshlet_count", _culling.flat_visible_meshlet_count);
+        writer.field("group_tests", _culling.group_tests);
+        writer.field("grouped_meshlet_tests", _culling.grouped_meshlet_tests);
+        writer.field("grouped_visible_meshlet_count", _culling.grouped_visible_meshlet_count);
+        writer.field("bvh_box_tests", _culling.bvh_box_tests);
+        writer.field("bvh_meshlet_tests", _culling.bvh_meshlet_tests);
+        writer.field("bvh_visible_meshlet_count", _culling.bvh_visible_meshlet_count);
+        writer.end('}');
+
+        if(_cluster_lod.cluster_count > 0) {
+            writer.key("cluster_lod");
+            writer.begin('{');
+            writer.field("level_count", _cluster_lod.level_count);
+            writer.field("cluster_count", _cluster_lod.cluster_count);
+            writer.field("view_distances", _LOD_VIEW_DISTANCES);
+            writer.field("error_thresholds", _LOD_ERROR_THRESHOLDS);
+            writer.key("cut_triangle_counts");
+            writer.begin('[');
+            for(const auto& counts : _cluster_lod.cut_triangle_counts) {
+                writer.begin('[');
+                for(const auto count : counts) {
+                    writer.value(count);
+                }
+                writer.end(']');
+            }
+            writer.end(']');
+            writer.end('}');
+        }
+
+        if(!_lod_chain.level_errors.empty()) {
+            writer.key("lod_chain");
+            writer.begin('{');
+            writer.field("level_triangle_counts", _lod_chain.level_triangle_counts);
+            writer.field("level_meshlet_counts", _lod_chain.level_meshlet_counts);
+            writer.field("level_errors", _lod_chain.level_errors);
+            writer.field("view_distances", _LOD_VIEW_DISTANCES);
+            writer.field("error_threshold", _LOD_CHAIN_ERROR_THRESHOLD);
+            writer.field("selected_triangle_counts", _lod_chain.selected_triangle_counts);
+            writer.end('}');
+        }
+
+        if(_shadow_meshlets.meshlet_count > 0) {
+            const auto bytes = _shadow_meshlets.position_bytes + _shadow_meshlets.meshlet_data_bytes + _shadow_meshlets.meshlet_header_bytes;
+
+            writer.key("shadow_meshlets");
+            writer.begin('{');
+            writer.field("meshlet_count", _shadow_meshlets.meshlet_count);
+            writer.field("position_count", _shadow_meshlets.position_count);
+            writer.field("position_bytes", _shadow_meshlets.position_bytes);
+            writer.field("meshlet_data_bytes", _shadow_meshlets.meshlet_data_bytes);
+            writer.field("meshlet_header_bytes", _shadow_meshlets.meshlet_header_bytes);
+            writer.field("bytes_fetched", _shadow_meshlets.bytes_fetched);
+            writer.field("main_bytes", _shadow_meshlets.main_bytes);
+            writer.field("meshlet_ratio", static_cast<double>(_shadow_meshlets.meshlet_count) / static_cast<double>(std::max<size_t>(_meshlet_count, 1)));
+            writer.field("bytes_ratio", static_cast<double>(bytes) / static_cast<double>(std::max<size_t>(_shadow_meshlets.main_bytes, 1)));
+            writer.field("fetch_ratio", static_cast<double>(_shadow_meshlets.bytes_fetched) / static_cast<double>(std::max<size_t>(_vertex_fetch.bytes_fetched, 1)));
+            writer.end('}');
+        }
+
+        writer.key("vertex_fetch");
+        writer.begin('{');
+        writer.field("bytes_fetched", _vertex_fetch.bytes_fetched);
+        writer.field("overfetch", _vertex_fetch.overfetch);
+        writer.end('}');
+
+        writer.key("size_bytes");
+        writer.begin('{');
+        writer.field("meshlet_data", _meshlet_data_bytes);
+        writer.field("encoded_meshlet_data", _encoded_meshlet_data_bytes);
+        writer.field("encoded_vertex_references", _encoded_reference_bytes);
+        writer.end('}');
+
+        writer.end('}');
+        return std::move(writer.get_result());
+    }
+}
\ No newline at end of file
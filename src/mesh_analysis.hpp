@@ -0,0 +1,164 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <meshoptimizer/meshoptimizer.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace d3d12_mesh_shaders {
+    // Quality report over the meshlets of a built mesh. Everything in it is derived from the build output alone, so two
+    // reports of the same asset only differ if the cooker's output did.
+    class mesh_analysis final {
+    public:
+        static const size_t FILL_BINS = 10;
+        static const size_t CONE_ANGLE_BINS = 12;
+        static const size_t LOD_VIEW_DISTANCES = 3;
+        static const size_t LOD_ERROR_THRESHOLDS = 6;
+
+        struct distribution final {
+            double min;
+            double max;
+            double mean;
+            double p50;
+            double p90;
+            double p99;
+        };
+
+        // meshlet_culler over the views the report orbits the mesh with, summed
+        struct culling final {
+            size_t view_count;
+            size_t flat_meshlet_tests;
+            size_t flat_visible_meshlet_count;
+            size_t group_tests;
+            size_t grouped_meshlet_tests;
+            size_t grouped_visible_meshlet_count;
+            size_t bvh_box_tests;
+            size_t bvh_meshlet_tests;
+            size_t bvh_visible_meshlet_count;
+        };
+
+        // select_lod_clusters from the culling directions, further out, for a 1080 pixel high view; empty without a DAG
+        struct cluster_lod final {
+            size_t level_count;
+            size_t cluster_count;
+            // mean triangle count of the cut per view distance and error threshold
+            std::array<std::array<double, LOD_ERROR_THRESHOLDS>, LOD_VIEW_DISTANCES> cut_triangle_counts;
+        };
+
+        // the discrete LOD chain; empty without one
+        struct lod_chain final {
+            std::vector<size_t> level_triangle_counts;
+            std::vector<size_t> level_meshlet_counts;
+            std::vector<double> level_errors;
+            // triangles of the level lod_selector picks at 1 pixel of error from the cluster_lod view distances
+            std::array<size_t, LOD_VIEW_DISTANCES> selected_triangle_counts;
+        };
+
+        // the position-only meshlet set, see mesh::get_shadow_meshlets; empty without one
+        struct shadow_meshlets final {
+            size_t meshlet_count;
+            size_t position_count;
+            size_t position_bytes;
+            size_t meshlet_data_bytes;
+            size_t meshlet_header_bytes;
+            // the same three summed for the main set, whose vertex stream has the full vertex layout
+            size_t main_bytes;
+            // meshopt_analyzeVertexFetch over the position stream, comparable to the main set's
+            size_t bytes_fetched;
+        };
+    private:
+        size_t _meshlet_count;
+        size_t _vertex_count;
+        size_t _triangle_count;
+
+        mesh::meshlet_parameters _parameters;
+
+        // bin i counts meshlets filled to [i / FILL_BINS, (i + 1) / FILL_BINS) of the limit, a full meshlet goes in the last bin
+        std::array<size_t, FILL_BINS> _vertex_fill_histogram {};
+        std::array<size_t, FILL_BINS> _triangle_fill_histogram {};
+
+        // average triangle count over max_triangles
+        double _fill_ratio;
+
+        // meshlets folded into others by merge_meshlets
+        size_t _merged_meshlet_count;
+
+        // meshlet vertex references per referenced vertex
+        double _vertex_duplication;
+
+        distribution _radius;
+        distribution _relative_radius;
+        distribution _group_relative_radius;
+
+        // full angle of the normal cone of the cullable meshlets in 15 degree bins, so a flat meshlet lands in the first bin; the
+        // cutoff meshopt stores is the sine of the half angle. Normal cones too wide to ever reject are not cullable
+        size_t _cullable_count;
+        std::array<size_t, CONE_ANGLE_BINS> _cone_angle_histogram {};
+
+        // over the index buffer the meshlets produce in order
+        meshopt_VertexFetchStatistics _vertex_fetch;
+
+        culling _culling;
+        cluster_lod _cluster_lod;
+        lod_chain _lod_chain;
+        shadow_meshlets _shadow_meshlets;
+
+        // Raw meshlet data, then meshopt_encodeVertexBuffer of it as 4 byte elements and meshopt_encodeIndexSequence of
+        // the meshlet vertex indices in order: how well the data compresses with meshopt's codecs.
+        size_t _meshlet_data_bytes;
+        size_t _encoded_reference_bytes;
+        size_t _encoded_meshlet_data_bytes;
+    public:
+        mesh_analysis(const mesh& mesh) noexcept;
+
+        [[nodiscard]] inline size_t get_meshlet_count() const noexcept {
+            return _meshlet_count;
+        }
+
+        [[nodiscard]] inline double get_fill_ratio() const noexcept {
+            return _fill_ratio;
+        }
+
+        [[nodiscard]] inline double get_vertex_duplication() const noexcept {
+            return _vertex_duplication;
+        }
+
+        [[nodiscard]] inline const distribution& get_radius() const noexcept {
+            return _radius;
+        }
+
+        [[nodiscard]] inline size_t get_cullable_count() const noexcept {
+            return _cullable_count;
+        }
+
+        [[nodiscard]] inline const culling& get_culling() const noexcept {
+            return _culling;
+        }
+
+        [[nodiscard]] inline const cluster_lod& get_cluster_lod() const noexcept {
+            return _cluster_lod;
+        }
+
+        [[nodiscard]] inline const lod_chain& get_lod_chain() const noexcept {
+            return _lod_chain;
+        }
+
+        [[nodiscard]] inline const shadow_meshlets& get_shadow_meshlets() const noexcept {
+            return _shadow_meshlets;
+        }
+
+        [[nodiscard]] inline const meshopt_VertexFetchStatistics& get_vertex_fetch() const noexcept {
+            return _vertex_fetch;
+        }
+
+        [[nodiscard]] inline size_t get_encoded_meshlet_data_bytes() const noexcept {
+            return _encoded_meshlet_data_bytes;
+        }
+
+        [[nodiscard]] std::string to_json() const noexcept;
+    };
+}
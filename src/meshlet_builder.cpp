@@ -0,0 +1,635 @@
+#include "meshlet_builder.hpp"
+#include "graph_clusterizer.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+
+namespace d3d12_mesh_shaders {
+    // meshlets this close in build order are merge candidates even without a shared vertex
+    static const size_t _MERGE_WINDOW = 8;
+
+    // a merge may grow the bounding radius of the larger meshlet by at most this factor; by meshlet_tuner's cost model a
+    // launch saved is worth more than the culling lost up to about there
+    static const float _MERGE_RADIUS_GROWTH = 2.0f;
+
+    struct merge_meshlet final {
+        // global vertex indices, unique, and three per triangle
+        std::vector<uint32_t> vertices;
+        std::vector<uint32_t> corners;
+
+        glm::vec3 center;
+        float radius;
+
+        bool modified;
+        bool removed;
+    };
+
+    static void build_meshlets(const uint32_t* indices, size_t index_count, const float* positions, size_t vertex_count, size_t stride,
+                               const mesh::meshlet_parameters& parameters, meshlet_build& build) noexcept {
+        const auto max_vertices = parameters.max_vertices, max_triangles = parameters.max_triangles;
+
+        if(parameters.clusterizer == mesh::meshlet_clusterizer::graph) {
+            build_graph_meshlets(indices, index_count, positions, vertex_count, stride, max_vertices, max_triangles, build);
+            return;
+        }
+
+        const auto max_meshlets = meshopt_buildMeshletsBound(index_count, max_vertices, max_triangles);
+
+        build.meshlets.resize(max_meshlets);
+        build.vertices.resize(max_meshlets * max_vertices);
+        build.triangles.resize(max_meshlets * max_triangles * 3);
+
+        const auto meshlet_count = parameters.clusterizer == mesh::meshlet_clusterizer::scan
+            ? meshopt_buildMeshletsScan(build.meshlets.data(), build.vertices.data(), build.triangles.data(), indices, index_count, vertex_count,
+                                        max_vertices, max_triangles)
+            : meshopt_buildMeshlets(build.meshlets.data(), build.vertices.data(), build.triangles.data(), indices, index_count,
+                                    positions, vertex_count, stride, max_vertices, max_triangles, parameters.cone_weight);
+
+        build.meshlets.resize(meshlet_count);
+    }
+
+    // Both clusterizers size their scratch by the vertex count, so a chunk that references only a small part of the mesh
+    // is first compacted to its own vertices in first-use order; otherwise each of many small chunks would pay for the whole
+    // mesh. The meshlet vertices are mapped back to global indices afterwards.
+    static void build_meshlets(const uint32_t* indices, size_t index_count, const std::vector<mesh::vertex>& vertices,
+                               const mesh::meshlet_parameters& parameters, meshlet_build& build) noexcept {
+        // an empty range has no positions to point the clusterizers at
+        if(index_count == 0) {
+            build.meshlets.clear();
+            build.vertices.clear();
+            build.triangles.clear();
+            return;
+        }
+
+        if(index_count >= vertices.size()) {
+            build_meshlets(indices, index_count, &vertices[0].position.x, vertices.size(), sizeof(mesh::vertex), parameters, build);
+            return;
+        }
+
+        size_t table_size = 1;
+        while(table_size < index_count + index_count / 4) {
+            table_size *= 2;
+        }
+
+        std::vector<uint32_t> table(table_size, ~0u);
+        std::vector<uint32_t> chunk_vertices;
+        std::vector<uint32_t> local_indices(index_count);
+
+        chunk_vertices.reserve(index_count / 4);
+
+        for(size_t i = 0; i < index_count; i++) {
+            const auto index = indices[i];
+
+            auto bucket = (index * 0x9e3779b1u) & (table_size - 1);
+            for(size_t probe = 1; table[bucket] != ~0u && chunk_vertices[table[bucket]] != index; probe++) {
+                bucket = (bucket + probe) & (table_size - 1);
+            }
+
+            if(table[bucket] == ~0u) {
+                table[bucket] = static_cast<uint32_t>(chunk_vertices.size());
+                chunk_vertices.push_back(index);
+            }
+
+            local_indices[i] = table[bucket];
+        }
+
+        std::vector<glm::vec3> local_positions(chunk_vertices.size());
+        for(size_t i = 0; i < chunk_vertices.size(); i++) {
+            local_positions[i] = vertices[chunk_vertices[i]].position;
+        }
+
+        build_meshlets(local_indices.data(), index_count, &local_positions[0].x, local_positions.size(), sizeof(glm::vec3), parameters, build);
+
+        for(const auto& meshlet : build.meshlets) {
+            for(uint32_t i = 0; i < meshlet.vertex_count; i++) {
+                auto& vertex = build.vertices[meshlet.vertex_offset + i];
+                vertex = chunk_vertices[vertex];
+            }
+        }
+    }
+
+    void pack_meshlets(const std::vector<meshlet_build>& builds, std::vector<mesh::meshlet>& meshlets, std::vector<uint32_t>& meshlet_data) noexcept {
+        size_t meshlet_count = 0, num_meshlet_data = 0;
+        for(const auto& build : builds) {
+            meshlet_count += build.meshlets.size();
+
+            for(const auto& meshlet : build.meshlets) {
+                num_meshlet_data += meshlet.vertex_count;
+                num_meshlet_data += (meshlet.triangle_count * 3 + 3) / 4;
+            }
+        }
+
+        meshlets.resize((meshlet_count + mesh::MESHLET_GROUP_SIZE - 1) / mesh::MESHLET_GROUP_SIZE * mesh::MESHLET_GROUP_SIZE);
+        meshlet_data.resize(num_meshlet_data);
+
+        size_t meshlet_index = 0, index = 0;
+
+        for(const auto& build : builds) {
+            for(const auto& meshlet : build.meshlets) {
+                const auto data_offset = index;
+
+                // num_meshlet_data counted every word, so a meshlet over the layout's limits can't be cut short here
+                if(meshlet.vertex_count > default_meshlet_config::max_vertices || meshlet.triangle_count > default_meshlet_config::max_triangles) {
+                    util::panic("meshlet_builder: meshlet exceeds the meshlet layout");
+                }
+
+                const auto* vertex_indices = build.vertices.data() + meshlet.vertex_offset;
+                for(uint32_t j = 0; j < meshlet.vertex_count; j++) {
+                    meshlet_data[index++] = vertex_indices[j];
+                }
+
+                // meshopt_buildMeshlets keeps triangle_offset 4 byte aligned, so the packed words can be copied straight
+                const auto* packed_indices = reinterpret_cast<const uint32_t*>(build.triangles.data() + meshlet.triangle_offset);
+                const auto num_packed_indices = (meshlet.triangle_count * 3 + 3) / 4;
+
+                for(uint32_t j = 0; j < num_packed_indices; j++) {
+                    meshlet_data[index++] = packed_indices[j];
+                }
+
+                new (meshlets.data() + meshlet_index++) mesh::meshlet(static_cast<uint32_t>(data_offset), meshlet.vertex_count, meshlet.triangle_count);
+            }
+        }
+    }
+
+    void build_meshlets(const mesh::meshlet_parameters& parameters, const uint32_t* indices, size_t index_count, const std::vector<mesh::vertex>& vertices,
+                        meshlet_build& build) noexcept {
+        if(parameters.max_vertices != 32 && parameters.max_vertices != 64 && parameters.max_vertices != 128) {
+            util::panic("build_meshlets: unsupported max_vertices");
+        }
+
+        if(parameters.max_triangles != 64 && parameters.max_triangles != 124 && parameters.max_triangles != 256) {
+            util::panic("build_meshlets: unsupported max_triangles");
+        }
+
+        build_meshlets(indices, index_count, vertices, parameters, build);
+    }
+
+    static void update_merge_bounds(merge_meshlet& meshlet, const std::vector<mesh::vertex>& vertices) noexcept {
+        auto min = glm::vec3(std::numeric_limits<float>::max()), max = glm::vec3(-std::numeric_limits<float>::max());
+        for(const auto index : meshlet.vertices) {
+            min = glm::min(min, vertices[index].position);
+            max = glm::max(max, vertices[index].position);
+        }
+
+        meshlet.center = (min + max) * 0.5f;
+        meshlet.radius = 0.0f;
+
+        for(const auto index : meshlet.vertices) {
+            meshlet.radius = std::max(meshlet.radius, glm::length(vertices[index].position - meshlet.center));
+        }
+    }
+
+    // radius of the sphere update_merge_bounds would give the two meshlets combined
+    static float get_merged_radius(const merge_meshlet& a, const merge_meshlet& b, const std::vector<mesh::vertex>& vertices) noexcept {
+        auto min = glm::vec3(std::numeric_limits<float>::max()), max = glm::vec3(-std::numeric_limits<float>::max());
+        for(const auto* meshlet : { &a, &b }) {
+            for(const auto index : meshlet->vertices) {
+                min = glm::min(min, vertices[index].position);
+                max = glm::max(max, vertices[index].position);
+            }
+        }
+
+        const auto center = (min + max) * 0.5f;
+
+        auto radius = 0.0f;
+        for(const auto* meshlet : { &a, &b }) {
+            for(const auto index : meshlet->vertices) {
+                radius = std::max(radius, glm::length(vertices[index].position - center));
+            }
+        }
+
+        return radius;
+    }
+
+    static inline uint32_t count_new_vertices(const std::vector<uint32_t>& meshlet_vertices, const uint32_t* indices, size_t index_count) noexcept {
+        uint32_t count = 0;
+        for(size_t i = 0; i < index_count; i++) {
+            // a triangle may repeat a new vertex, count it once
+            const auto is_new = std::find(meshlet_vertices.begin(), meshlet_vertices.end(), indices[i]) == meshlet_vertices.end()
+                                && std::find(indices, indices + i, indices[i]) == indices + i;
+            count += is_new;
+        }
+
+        return count;
+    }
+
+    static inline void add_corners(merge_meshlet& meshlet, const uint32_t* corners, size_t corner_count) noexcept {
+        for(size_t i = 0; i < corner_count; i++) {
+            if(std::find(meshlet.vertices.begin(), meshlet.vertices.end(), corners[i]) == meshlet.vertices.end()) {
+                meshlet.vertices.push_back(corners[i]);
+            }
+
+            meshlet.corners.push_back(corners[i]);
+        }
+
+        meshlet.modified = true;
+    }
+
+    size_t merge_meshlets(const mesh::meshlet_parameters& parameters, const std::vector<mesh::vertex>& vertices, meshlet_build& build) noexcept {
+        const auto is_underfilled = [&](const merge_meshlet& meshlet) noexcept {
+            return meshlet.corners.size() / 3 * 2 <= parameters.max_triangles || meshlet.vertices.size() * 2 <= parameters.max_vertices;
+        };
+
+        const auto meshlet_count = build.meshlets.size();
+
+        std::vector<merge_meshlet> meshlets(meshlet_count);
+        std::vector<uint32_t> order;
+
+        for(size_t i = 0; i < meshlet_count; i++) {
+            const auto& source = build.meshlets[i];
+            auto& meshlet = meshlets[i];
+
+            meshlet.vertices.assign(build.vertices.begin() + source.vertex_offset, build.vertices.begin() + source.vertex_offset + source.vertex_count);
+            meshlet.corners.resize(source.triangle_count * 3);
+
+            for(size_t j = 0; j < meshlet.corners.size(); j++) {
+                meshlet.corners[j] = meshlet.vertices[build.triangles[source.triangle_offset + j]];
+            }
+
+            update_merge_bounds(meshlet, vertices);
+            meshlet.modified = false;
+            meshlet.removed = false;
+
+            if(is_underfilled(meshlet)) {
+                order.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        if(order.empty()) {
+            return 0;
+        }
+
+        // emptiest first, they are the cheapest to place and the most wasteful to keep
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) noexcept {
+            return meshlets[a].corners.size() < meshlets[b].corners.size();
+        });
+
+        // (vertex, meshlet) sorted by vertex; a meshlet merged away forwards to the meshlet that took it in
+        std::vector<std::pair<uint32_t, uint32_t>> vertex_meshlets;
+        for(size_t i = 0; i < meshlet_count; i++) {
+            for(const auto index : meshlets[i].vertices) {
+                vertex_meshlets.emplace_back(index, static_cast<uint32_t>(i));
+            }
+        }
+
+        std::sort(vertex_meshlets.begin(), vertex_meshlets.end());
+
+        std::vector<uint32_t> owners(meshlet_count);
+        std::iota(owners.begin(), owners.end(), 0u);
+
+        const auto find_owner = [&](uint32_t meshlet) noexcept {
+            while(owners[meshlet] != meshlet) {
+                meshlet = owners[meshlet] = owners[owners[meshlet]];
+            }
+
+            return meshlet;
+        };
+
+        std::vector<uint32_t> candidates;
+        std::vector<merge_meshlet> planned;
+        std::vector<uint32_t> targets;
+
+        size_t removed_count = 0;
+
+        for(const auto small_index : order) {
+            auto& small = meshlets[small_index];
+            if(small.removed || !is_underfilled(small)) {
+                continue;
+            }
+
+            candidates.clear();
+
+            const auto add_candidate = [&](uint32_t meshlet) noexcept {
+                const auto owner = find_owner(meshlet);
+                if(owner != small_index && !meshlets[owner].removed) {
+                    candidates.push_back(owner);
+                }
+            };
+
+            for(const auto index : small.vertices) {
+                auto it = std::lower_bound(vertex_meshlets.begin(), vertex_meshlets.end(), std::make_pair(index, 0u));
+                for(; it != vertex_meshlets.end() && it->first == index; ++it) {
+                    add_candidate(it->second);
+                }
+            }
+
+            const auto window_end = std::min<size_t>(small_index + _MERGE_WINDOW + 1, meshlet_count);
+            for(auto i = small_index > _MERGE_WINDOW ? small_index - _MERGE_WINDOW : 0; i < window_end; i++) {
+                add_candidate(static_cast<uint32_t>(i));
+            }
+
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+            // whole: the candidate that fits and gives the tightest combined sphere
+            auto best = ~0u;
+            auto best_radius = std::numeric_limits<float>::max();
+
+            for(const auto candidate : candidates) {
+                const auto& other = meshlets[candidate];
+
+                if(other.corners.size() + small.corners.size() > parameters.max_triangles * 3
+                   || other.vertices.size() + count_new_vertices(other.vertices, small.vertices.data(), small.vertices.size()) > parameters.max_vertices) {
+                    continue;
+                }
+
+                const auto radius = get_merged_radius(other, small, vertices);
+                if(radius <= _MERGE_RADIUS_GROWTH * std::max(other.radius, small.radius) && radius < best_radius) {
+                    best = candidate;
+                    best_radius = radius;
+                }
+            }
+
+            if(best != ~0u) {
+                auto& other = meshlets[best];
+                add_corners(other, small.corners.data(), small.corners.size());
+                update_merge_bounds(other, vertices);
+
+                small.removed = true;
+                owners[small_index] = best;
+                removed_count++;
+                continue;
+            }
+
+            // Rebalance: spread the triangles over the candidates, each to the one it adds the fewest vertices to among
+            // those with room whose sphere it stays near. Planned on copies, so a meshlet that can't be emptied is kept as it was.
+            if(candidates.empty()) {
+                continue;
+            }
+
+            planned.resize(candidates.size());
+            for(size_t i = 0; i < candidates.size(); i++) {
+                planned[i].vertices = meshlets[candidates[i]].vertices;
+                planned[i].corners.clear();
+            }
+
+            targets.clear();
+
+            const auto triangle_count = small.corners.size() / 3;
+            for(size_t i = 0; i < triangle_count; i++) {
+                const auto* corners = small.corners.data() + i * 3;
+
+                auto target = ~0u;
+                auto target_vertices = ~0u;
+
+                for(size_t j = 0; j < candidates.size(); j++) {
+                    const auto& other = meshlets[candidates[j]];
+                    if(other.corners.size() + planned[j].corners.size() + 3 > parameters.max_triangles * 3) {
+                        continue;
+                    }
+
+                    auto near = true;
+                    for(size_t k = 0; k < 3; k++) {
+                        near = near && glm::length(vertices[corners[k]].position - other.center) <= _MERGE_RADIUS_GROWTH * other.radius;
+                    }
+
+                    const auto new_vertices = count_new_vertices(planned[j].vertices, corners, 3);
+                    if(near && planned[j].vertices.size() + new_vertices <= parameters.max_vertices && new_vertices < target_vertices) {
+                        target = static_cast<uint32_t>(j);
+                        target_vertices = new_vertices;
+                    }
+                }
+
+                if(target == ~0u) {
+                    break;
+                }
+
+                add_corners(planned[target], corners, 3);
+                targets.push_back(target);
+            }
+
+            if(targets.size() != triangle_count) {
+                continue;
+            }
+
+            for(size_t i = 0; i < candidates.size(); i++) {
+                if(planned[i].corners.empty()) {
+                    continue;
+                }
+
+                auto& other = meshlets[candidates[i]];
+                add_corners(other, planned[i].corners.data(), planned[i].corners.size());
+                update_merge_bounds(other, vertices);
+            }
+
+            small.removed = true;
+            owners[small_index] = candidates[targets[0]];
+            removed_count++;
+        }
+
+        if(removed_count == 0) {
+            return 0;
+        }
+
+        meshlet_build result;
+        result.vertices.reserve(build.vertices.size());
+        result.triangles.reserve(build.triangles.size());
+
+        for(size_t i = 0; i < meshlet_count; i++) {
+            const auto& meshlet = meshlets[i];
+            if(meshlet.removed) {
+                continue;
+            }
+
+            const auto vertex_offset = result.vertices.size(), triangle_offset = result.triangles.size();
+            result.vertices.insert(result.vertices.end(), meshlet.vertices.begin(), meshlet.vertices.end());
+
+            if(meshlet.modified) {
+                for(const auto index : meshlet.corners) {
+                    const auto local = std::find(meshlet.vertices.begin(), meshlet.vertices.end(), index) - meshlet.vertices.begin();
+                    result.triangles.push_back(static_cast<uint8_t>(local));
+                }
+            } else {
+                const auto* source_triangles = build.triangles.data() + build.meshlets[i].triangle_offset;
+                result.triangles.insert(result.triangles.end(), source_triangles, source_triangles + meshlet.corners.size());
+            }
+
+            // keep triangle_offset 4 byte aligned like meshopt_buildMeshlets, pack_meshlets copies whole words
+            result.triangles.resize((result.triangles.size() + 3) & ~size_t(3));
+
+            result.meshlets.push_back(meshopt_Meshlet {
+                .vertex_offset = static_cast<unsigned int>(vertex_offset),
+                .triangle_offset = static_cast<unsigned int>(triangle_offset),
+                .vertex_count = static_cast<unsigned int>(meshlet.vertices.size()),
+                .triangle_count = static_cast<unsigned int>(meshlet.corners.size() / 3)
+            });
+        }
+
+        build = std::move(result);
+        return removed_count;
+    }
+
+    void optimize_meshlet(uint32_t* meshlet_vertices, uint8_t* meshlet_triangles, uint32_t vertex_count, uint32_t triangle_count) noexcept {
+        static constexpr auto max_vertices = default_meshlet_config::max_vertices;
+        static constexpr auto max_triangles = default_meshlet_config::max_triangles;
+        static constexpr uint16_t none = 0xffff;
+
+        if(vertex_count > max_vertices || triangle_count > max_triangles) {
+            util::panic("optimize_meshlet: meshlet exceeds the compiled meshlet layout");
+        }
+
+        // triangles around each vertex
+        std::array<uint16_t, max_vertices + 1> vertex_offsets {};
+        std::array<uint16_t, max_triangles * 3> vertex_triangles;
+
+        for(uint32_t i = 0; i < triangle_count * 3; i++) {
+            vertex_offsets[meshlet_triangles[i] + 1]++;
+        }
+
+        for(uint32_t i = 0; i < vertex_count; i++) {
+            vertex_offsets[i + 1] += vertex_offsets[i];
+        }
+
+        std::array<uint16_t, max_vertices> vertex_fill;
+        std::copy(vertex_offsets.begin(), vertex_offsets.begin() + vertex_count, vertex_fill.begin());
+
+        for(uint32_t i = 0; i < triangle_count * 3; i++) {
+            vertex_triangles[vertex_fill[meshlet_triangles[i]]++] = static_cast<uint16_t>(i / 3);
+        }
+
+        // edge neighbours, and how many of them are still to be emitted
+        std::array<std::array<uint16_t, 3>, max_triangles> neighbours;
+        std::array<uint8_t, max_triangles> live {};
+        std::array<uint8_t, max_triangles> emitted {};
+
+        for(uint32_t i = 0; i < triangle_count; i++) {
+            for(uint32_t j = 0; j < 3; j++) {
+                const auto a = meshlet_triangles[i * 3 + j], b = meshlet_triangles[i * 3 + (j + 1) % 3];
+
+                neighbours[i][j] = none;
+                for(auto k = vertex_offsets[a]; k < vertex_offsets[a + 1] && neighbours[i][j] == none; k++) {
+                    const auto other = vertex_triangles[k];
+                    const auto* corners = meshlet_triangles + other * 3;
+
+                    if(other != i && (corners[0] == b || corners[1] == b || corners[2] == b)) {
+                        neighbours[i][j] = other;
+                        live[i]++;
+                    }
+                }
+            }
+        }
+
+        // the unemitted triangle with the fewest unemitted neighbours among candidates, so strips start at the boundary
+        // and don't strand single triangles behind them
+        const auto pick = [&](uint16_t best, uint16_t candidate) noexcept {
+            return emitted[candidate] == 0 && (best == none || live[candidate] < live[best]) ? candidate : best;
+        };
+
+        std::array<uint16_t, max_triangles> order;
+        uint16_t current = none;
+
+        for(uint32_t i = 0; i < triangle_count; i++) {
+            current = pick(current, static_cast<uint16_t>(i));
+        }
+
+        for(uint32_t i = 0; i < triangle_count; i++) {
+            order[i] = current;
+            emitted[current] = 1;
+
+            for(const auto neighbour : neighbours[current]) {
+                if(neighbour != none) {
+                    live[neighbour]--;
+                }
+            }
+
+            // continue across an edge, else around a vertex, else from the latest triangle with an open edge, else anywhere
+            auto next = none;
+            for(const auto neighbour : neighbours[current]) {
+                if(neighbour != none) {
+                    next = pick(next, neighbour);
+                }
+            }
+
+            for(uint32_t j = 0; j < 3 && next == none; j++) {
+                const auto vertex = meshlet_triangles[current * 3 + j];
+                for(auto k = vertex_offsets[vertex]; k < vertex_offsets[vertex + 1]; k++) {
+                    next = pick(next, vertex_triangles[k]);
+                }
+            }
+
+            for(auto j = i; j-- > 0 && next == none;) {
+                for(const auto neighbour : neighbours[order[j]]) {
+                    if(neighbour != none) {
+                        next = pick(next, neighbour);
+                    }
+                }
+            }
+
+            for(uint32_t j = 0; j < triangle_count && next == none; j++) {
+                next = pick(next, static_cast<uint16_t>(j));
+            }
+
+            current = next;
+        }
+
+        // Writes the triangles in the given order with vertices numbered in first use order. With rotate, each triangle starts
+        // with the edge it shares with its predecessor, which keeps the winding and leaves the one new vertex last. Returns
+        // the bits meshopt_encodeVertexBuffer would roughly spend on the packed triangles.
+        const auto renumber = [&](const uint16_t* triangle_order, bool rotate, uint8_t* triangles, uint32_t* vertices) noexcept {
+            std::array<uint8_t, max_vertices> remap;
+            remap.fill(0xff);
+
+            uint32_t remapped_count = 0;
+            for(uint32_t i = 0; i < triangle_count; i++) {
+                const auto* corners = meshlet_triangles + triangle_order[i] * 3;
+
+                uint32_t rotation = 0;
+                for(uint32_t j = 0; j < 3 && i > 0 && rotate; j++) {
+                    if(neighbours[triangle_order[i]][j] == triangle_order[i - 1]) {
+                        rotation = j;
+                    }
+                }
+
+                for(uint32_t j = 0; j < 3; j++) {
+                    const auto corner = corners[(j + rotation) % 3];
+                    if(remap[corner] == 0xff) {
+                        remap[corner] = static_cast<uint8_t>(remapped_count);
+                        vertices[remapped_count++] = meshlet_vertices[corner];
+                    }
+
+                    triangles[i * 3 + j] = remap[corner];
+                }
+            }
+
+            // meshopt_encodeVertexBuffer's scheme: per byte of the word, zigzag deltas in groups of 16 words stored at 0, 2,
+            // 4 or 8 bits depending on the largest
+            const auto word_count = (triangle_count * 3 + 3) / 4;
+            std::fill(triangles + triangle_count * 3, triangles + word_count * 4, uint8_t(0));
+
+            uint32_t cost = 0;
+            for(uint32_t group = 0; group < word_count; group += 16) {
+                for(uint32_t lane = 0; lane < 4; lane++) {
+                    uint32_t largest = 0;
+                    for(auto i = group; i < word_count && i < group + 16; i++) {
+                        const auto delta = static_cast<int8_t>(triangles[i * 4 + lane] - (i > 0 ? triangles[(i - 1) * 4 + lane] : 0));
+                        largest = std::max(largest, static_cast<uint32_t>((delta << 1) ^ (delta >> 7)) & 0xff);
+                    }
+
+                    cost += largest == 0 ? 0 : largest < 4 ? 2 : largest < 16 ? 4 : 8;
+                }
+            }
+
+            return cost;
+        };
+
+        // The clusterizer's own order is often just as coherent, the graph clusterizer's in particular, so it is kept when
+        // the strip order doesn't beat it.
+        std::array<uint16_t, max_triangles> source_order;
+        std::iota(source_order.begin(), source_order.begin() + triangle_count, uint16_t(0));
+
+        std::array<uint8_t, default_meshlet_config::max_packed_triangle_words * 4> strip_triangles, source_triangles;
+        std::array<uint32_t, max_vertices> strip_vertices, source_vertices;
+
+        const auto strip_cost = renumber(order.data(), true, strip_triangles.data(), strip_vertices.data());
+        const auto source_cost = renumber(source_order.data(), false, source_triangles.data(), source_vertices.data());
+
+        const auto& triangles = strip_cost <= source_cost ? strip_triangles : source_triangles;
+        const auto& vertices = strip_cost <= source_cost ? strip_vertices : source_vertices;
+
+        std::copy(vertices.begin(), vertices.begin() + vertex_count, meshlet_vertices);
+        std::copy(triangles.begin(), triangles.begin() + triangle_count * 3, meshlet_triangles);
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <meshoptimizer/meshoptimizer.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace d3d12_mesh_shaders {
+    // meshopt_buildMeshlets output for one index range, vertex indices global to the mesh
+    struct meshlet_build final {
+        std::vector<meshopt_Meshlet> meshlets;
+        std::vector<uint32_t> vertices;
+        std::vector<uint8_t> triangles;
+    };
+
+    // Clusterizes one index range. The limits must name one of the meshlet_config layouts; meshopt takes them at runtime, so
+    // every layout shares one builder.
+    void build_meshlets(const mesh::meshlet_parameters& parameters, const uint32_t* indices, size_t index_count, const std::vector<mesh::vertex>& vertices,
+                        meshlet_build& build) noexcept;
+
+    // Folds underfilled meshlets (at most half of either limit) into spatially adjacent meshlets of the same build: whole,
+    // when the combined vertex and triangle counts fit the limits, or otherwise triangle by triangle into whichever
+    // neighbours have room. Neighbours are meshlets sharing a vertex or close in build order, and a merge may only grow the
+    // bounding sphere of the larger meshlet by a bounded factor. Returns the number of meshlets removed.
+    size_t merge_meshlets(const mesh::meshlet_parameters& parameters, const std::vector<mesh::vertex>& vertices, meshlet_build& build) noexcept;
+
+    // Reorders one packed meshlet in place for locality: triangles are walked across shared edges like a strip, starting
+    // where the fewest neighbours are left, and vertices are renumbered in first use order. The clusterizer's triangle order is
+    // kept where it would encode smaller. The meshlet must fit default_meshlet_config.
+    void optimize_meshlet(uint32_t* meshlet_vertices, uint8_t* meshlet_triangles, uint32_t vertex_count, uint32_t triangle_count) noexcept;
+
+    // Concatenates builds into the GPU layout: every meshlet's vertex indices followed by its packed triangles. meshlets is
+    // padded to a multiple of mesh::MESHLET_GROUP_SIZE with empty meshlets. Every build must fit default_meshlet_config.
+    void pack_meshlets(const std::vector<meshlet_build>& builds, std::vector<mesh::meshlet>& meshlets, std::vector<uint32_t>& meshlet_data) noexcept;
+}
@@ -0,0 +1,135 @@
+#include "meshlet_bvh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace d3d12_mesh_shaders {
+    struct bvh_group final {
+        glm::vec3 min;
+        glm::vec3 max;
+        glm::vec3 centroid;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    static size_t split_groups(bvh_group* groups, size_t count) noexcept {
+        auto min = glm::vec3(std::numeric_limits<float>::max()), max = glm::vec3(-std::numeric_limits<float>::max());
+        for(size_t i = 0; i < count; i++) {
+            min = glm::min(min, groups[i].centroid);
+            max = glm::max(max, groups[i].centroid);
+        }
+
+        const auto extent = max - min;
+        const auto axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+
+        const auto middle = count / 2;
+        std::nth_element(groups, groups + middle, groups + count, [&](const bvh_group& a, const bvh_group& b) noexcept {
+            return a.centroid[axis] < b.centroid[axis];
+        });
+
+        return middle;
+    }
+
+    static uint32_t build_node(bvh_group* groups, size_t count, std::vector<mesh::meshlet_bvh_node>& nodes) noexcept {
+        const auto index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+
+        std::array<size_t, 5> ranges {};
+        size_t range_count;
+
+        if(count <= 4) {
+            for(size_t i = 0; i <= count; i++) {
+                ranges[i] = i;
+            }
+
+            range_count = count;
+        } else {
+            const auto half = split_groups(groups, count);
+
+            ranges = { 0, split_groups(groups, half), half, half + split_groups(groups + half, count - half), count };
+            range_count = 4;
+        }
+
+        for(size_t i = 0; i < 4; i++) {
+            auto min = glm::vec3(std::numeric_limits<float>::max()), max = glm::vec3(-std::numeric_limits<float>::max());
+            auto child = ~0u, meshlet_count = 0u;
+
+            if(i < range_count) {
+                for(auto j = ranges[i]; j < ranges[i + 1]; j++) {
+                    min = glm::min(min, groups[j].min);
+                    max = glm::max(max, groups[j].max);
+                }
+
+                if(ranges[i + 1] - ranges[i] == 1) {
+                    child = groups[ranges[i]].first;
+                    meshlet_count = groups[ranges[i]].count;
+                } else {
+                    child = build_node(groups + ranges[i], ranges[i + 1] - ranges[i], nodes);
+                }
+            }
+
+            // nodes may have grown, so the node is only looked up once its children are built
+            auto& node = nodes[index];
+            node.min_x[i] = min.x;
+            node.min_y[i] = min.y;
+            node.min_z[i] = min.z;
+            node.max_x[i] = max.x;
+            node.max_y[i] = max.y;
+            node.max_z[i] = max.z;
+            node.children[i] = child;
+            node.meshlet_counts[i] = meshlet_count;
+        }
+
+        return index;
+    }
+
+    // get_group_count(first, end) is how many meshlets of [first, end) the group's leaf holds, from first on
+    template<typename GetGroupCount>
+    static void build_groups(std::span<const mesh::meshlet_bounds> meshlet_bounds, GetGroupCount&& get_group_count, std::vector<mesh::meshlet_bvh_node>& nodes) noexcept {
+        nodes.clear();
+
+        std::vector<bvh_group> groups;
+        for(size_t first = 0; first < meshlet_bounds.size(); first += mesh::MESHLET_GROUP_SIZE) {
+            const auto count = get_group_count(first, std::min<size_t>(first + mesh::MESHLET_GROUP_SIZE, meshlet_bounds.size()));
+            if(count == 0) {
+                continue;
+            }
+
+            auto& group = groups.emplace_back();
+            group.first = static_cast<uint32_t>(first);
+            group.count = static_cast<uint32_t>(count);
+            group.min = glm::vec3(std::numeric_limits<float>::max());
+            group.max = glm::vec3(-std::numeric_limits<float>::max());
+
+            for(auto j = group.first; j < group.first + group.count; j++) {
+                group.min = glm::min(group.min, meshlet_bounds[j].center - meshlet_bounds[j].radius);
+                group.max = glm::max(group.max, meshlet_bounds[j].center + meshlet_bounds[j].radius);
+            }
+
+            group.centroid = (group.min + group.max) * 0.5f;
+        }
+
+        if(!groups.empty()) {
+            build_node(groups.data(), groups.size(), nodes);
+        }
+    }
+
+    void build_meshlet_bvh(std::span<const mesh::meshlet_bounds> meshlet_bounds, std::vector<mesh::meshlet_bvh_node>& nodes) noexcept {
+        build_groups(meshlet_bounds, [](size_t first, size_t end) noexcept {
+            return end - first;
+        }, nodes);
+    }
+
+    void build_meshlet_bvh(std::span<const mesh::meshlet> meshlets, std::span<const mesh::meshlet_bounds> meshlet_bounds,
+                           std::vector<mesh::meshlet_bvh_node>& nodes) noexcept {
+        build_groups(meshlet_bounds, [&](size_t first, size_t end) noexcept {
+            auto last = first;
+            while(last < end && meshlets[last].triangle_count > 0) {
+                last++;
+            }
+
+            return last - first;
+        }, nodes);
+    }
+}
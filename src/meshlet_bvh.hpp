@@ -0,0 +1,19 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <span>
+#include <vector>
+
+namespace d3d12_mesh_shaders {
+    // Builds the 4-wide BVH of mesh::meshlet_bvh_node over meshlet spheres, root first. The leaves are the groups of
+    // MESHLET_GROUP_SIZE consecutive meshlets, so it relies on the groups being compact as mesh lays them out, and a leaf
+    // is never split. Each node halves its groups at the median centroid along their longest centroid axis and halves
+    // both halves again the same way, which gives the four children. meshlet_bounds must not include the padding.
+    void build_meshlet_bvh(std::span<const mesh::meshlet_bounds> meshlet_bounds, std::vector<mesh::meshlet_bvh_node>& nodes) noexcept;
+
+    // Same over all of get_meshlets() and its bounds, padding included: a leaf holds the meshlets of its group up to the
+    // first padding meshlet, since every submesh pads the tail of its last group.
+    void build_meshlet_bvh(std::span<const mesh::meshlet> meshlets, std::span<const mesh::meshlet_bounds> meshlet_bounds,
+                           std::vector<mesh::meshlet_bvh_node>& nodes) noexcept;
+}
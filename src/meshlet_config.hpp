@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+// Set by CMake from MESHLET_MAX_VERTICES / MESHLET_MAX_TRIANGLES, which also generate shaders/meshlet_config.hlsli
+#ifndef D3D12_MESH_SHADERS_MESHLET_MAX_VERTICES
+#define D3D12_MESH_SHADERS_MESHLET_MAX_VERTICES 64
+#endif
+
+#ifndef D3D12_MESH_SHADERS_MESHLET_MAX_TRIANGLES
+#define D3D12_MESH_SHADERS_MESHLET_MAX_TRIANGLES 124
+#endif
+
+namespace d3d12_mesh_shaders {
+    // Meshlet limits as compile-time constants. default_meshlet_config is the layout the shaders are compiled for; it sizes
+    // the fixed scratch of optimize_meshlet and bounds every meshlet pack_meshlets writes. The clusterizers take their
+    // limits at runtime, so the other layouts only name the limit pairs a build may ask for. Triangles are stored as three
+    // byte indices packed four to a uint32_t, behind the meshlet's vertex indices.
+    template<uint32_t MaxVertices, uint32_t MaxTriangles>
+    struct meshlet_config final {
+        static_assert(MaxVertices == 32 || MaxVertices == 64 || MaxVertices == 128, "meshlet_config: max vertices must be 32, 64 or 128");
+        static_assert(MaxTriangles == 64 || MaxTriangles == 124 || MaxTriangles == 256, "meshlet_config: max triangles must be 64, 124 or 256");
+
+        static constexpr uint32_t max_vertices = MaxVertices;
+        static constexpr uint32_t max_triangles = MaxTriangles;
+
+        static constexpr uint32_t max_packed_triangle_words = (MaxTriangles * 3 + 3) / 4;
+        static constexpr uint32_t max_data_words = MaxVertices + max_packed_triangle_words;
+    };
+
+    using default_meshlet_config = meshlet_config<D3D12_MESH_SHADERS_MESHLET_MAX_VERTICES, D3D12_MESH_SHADERS_MESHLET_MAX_TRIANGLES>;
+}
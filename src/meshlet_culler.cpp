@@ -0,0 +1,164 @@
+#include "meshlet_culler.hpp"
+
+#include <xmmintrin.h>
+
+namespace d3d12_mesh_shaders {
+    meshlet_culler::meshlet_culler(const glm::mat4& view_projection, const glm::vec3& camera_position) noexcept : _camera_position(camera_position) {
+        const auto row = [&](int i) noexcept {
+            return glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+        };
+
+        _planes[0] = row(3) + row(0);
+        _planes[1] = row(3) - row(0);
+        _planes[2] = row(3) + row(1);
+        _planes[3] = row(3) - row(1);
+        _planes[4] = row(2);
+        _planes[5] = row(3) - row(2);
+
+        for(auto& plane : _planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+    }
+
+    bool meshlet_culler::is_sphere_outside(const glm::vec3& center, float radius) const noexcept {
+        for(const auto& plane : _planes) {
+            if(glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool meshlet_culler::is_meshlet_visible(const mesh::meshlet_bounds& bounds, bool test_frustum) const noexcept {
+        if(test_frustum && is_sphere_outside(bounds.center, bounds.radius)) {
+            return false;
+        }
+
+        const auto axis = glm::vec3(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]) / 127.0f;
+        return glm::dot(glm::normalize(bounds.cone_apex - _camera_position), axis) < bounds.cone_cutoff / 127.0f;
+    }
+
+    meshlet_culler::result meshlet_culler::cull(const mesh& mesh, bool use_groups, std::vector<uint32_t>& visible_meshlets) const noexcept {
+        const auto& meshlets = mesh.get_meshlets();
+        const auto& meshlet_bounds = mesh.get_meshlet_bounds();
+        const auto& group_bounds = mesh.get_meshlet_group_bounds();
+
+        result result {};
+        visible_meshlets.clear();
+
+        for(size_t i = 0; i < group_bounds.size(); i++) {
+            if(use_groups) {
+                const auto& group = group_bounds[i];
+                result.group_tests++;
+
+                const auto offset = group.center - _camera_position;
+                if(is_sphere_outside(group.center, group.radius) || glm::dot(offset, group.cone_axis) >= group.cone_cutoff * glm::length(offset) + group.radius) {
+                    continue;
+                }
+            }
+
+            for(auto j = i * mesh::MESHLET_GROUP_SIZE; j < (i + 1) * mesh::MESHLET_GROUP_SIZE && meshlets[j].triangle_count > 0; j++) {
+                result.meshlet_tests++;
+                if(is_meshlet_visible(meshlet_bounds[j], true)) {
+                    visible_meshlets.push_back(static_cast<uint32_t>(j));
+                }
+            }
+        }
+
+        result.visible_meshlet_count = visible_meshlets.size();
+        return result;
+    }
+
+    meshlet_culler::result meshlet_culler::cull(std::span<const mesh::meshlet_bounds> meshlet_bounds, std::vector<uint32_t>& visible_meshlets) const noexcept {
+        visible_meshlets.clear();
+
+        for(size_t i = 0; i < meshlet_bounds.size(); i++) {
+            if(is_meshlet_visible(meshlet_bounds[i], true)) {
+                visible_meshlets.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        return result { .node_tests = 0, .group_tests = 0, .meshlet_tests = meshlet_bounds.size(), .visible_meshlet_count = visible_meshlets.size() };
+    }
+
+    meshlet_culler::result meshlet_culler::cull(std::span<const mesh::meshlet_bvh_node> nodes, std::span<const mesh::meshlet_bounds> meshlet_bounds,
+                                                std::vector<uint32_t>& visible_meshlets) const noexcept {
+        result result {};
+        visible_meshlets.clear();
+
+        if(nodes.empty()) {
+            return result;
+        }
+
+        // Per plane, the box corner furthest along the normal decides whether a box is outside and the nearest whether it
+        // is inside. The corners are picked by the sign of each normal component, as indices into the node's bound arrays.
+        struct plane final {
+            __m128 x, y, z, w;
+            uint32_t far_x, far_y, far_z;
+        };
+
+        std::array<plane, 6> planes;
+        for(size_t i = 0; i < planes.size(); i++) {
+            const auto& source = _planes[i];
+            planes[i] = plane {
+                .x = _mm_set1_ps(source.x), .y = _mm_set1_ps(source.y), .z = _mm_set1_ps(source.z), .w = _mm_set1_ps(source.w),
+                .far_x = source.x >= 0.0f ? 3u : 0u, .far_y = source.y >= 0.0f ? 4u : 1u, .far_z = source.z >= 0.0f ? 5u : 2u
+            };
+        }
+
+        // node index and whether its box is known to be inside; median splits keep the tree about log4 of the group count deep
+        std::array<std::pair<uint32_t, bool>, 256> stack;
+        size_t stack_size = 0;
+        stack[stack_size++] = { 0u, false };
+
+        const auto zero = _mm_setzero_ps();
+
+        while(stack_size > 0) {
+            const auto [index, parent_inside] = stack[--stack_size];
+            const auto& node = nodes[index];
+
+            int outside_mask = 0, inside_mask = 0xf;
+            if(!parent_inside) {
+                result.node_tests += 4;
+
+                const float* bounds[6] = { node.min_x, node.min_y, node.min_z, node.max_x, node.max_y, node.max_z };
+                const auto get_distance = [&](const plane& plane, uint32_t x, uint32_t y, uint32_t z) noexcept {
+                    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane.x, _mm_load_ps(bounds[x])), _mm_mul_ps(plane.y, _mm_load_ps(bounds[y]))),
+                                      _mm_add_ps(_mm_mul_ps(plane.z, _mm_load_ps(bounds[z])), plane.w));
+                };
+
+                auto outside = zero, inside = _mm_cmpeq_ps(zero, zero);
+                for(const auto& plane : planes) {
+                    outside = _mm_or_ps(outside, _mm_cmplt_ps(get_distance(plane, plane.far_x, plane.far_y, plane.far_z), zero));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(get_distance(plane, 3u - plane.far_x, 5u - plane.far_y, 7u - plane.far_z), zero));
+                }
+
+                outside_mask = _mm_movemask_ps(outside);
+                inside_mask = _mm_movemask_ps(inside);
+            }
+
+            for(uint32_t i = 0; i < 4; i++) {
+                if(node.children[i] == ~0u || (outside_mask >> i & 1) != 0) {
+                    continue;
+                }
+
+                const auto child_inside = (inside_mask >> i & 1) != 0;
+                if(node.meshlet_counts[i] == 0) {
+                    stack[stack_size++] = { node.children[i], child_inside };
+                    continue;
+                }
+
+                for(auto j = node.children[i]; j < node.children[i] + node.meshlet_counts[i]; j++) {
+                    result.meshlet_tests++;
+                    if(is_meshlet_visible(meshlet_bounds[j], !child_inside)) {
+                        visible_meshlets.push_back(j);
+                    }
+                }
+            }
+        }
+
+        result.visible_meshlet_count = visible_meshlets.size();
+        return result;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace d3d12_mesh_shaders {
+    // CPU reference of the culling meant for the amplification shader. With groups, each group of MESHLET_GROUP_SIZE
+    // meshlets is tested against the frustum and its normal cone first, and only the meshlets of the groups that pass are
+    // tested themselves; without, every meshlet is. Either way the visible meshlets are the same up to the group tests
+    // being looser, so the test counts of the two show what the groups save. The BVH query gives exactly the visible
+    // meshlets of the flat scan, in BVH order.
+    class meshlet_culler final {
+    public:
+        struct result final {
+            // child boxes tested, four per BVH node visited
+            size_t node_tests;
+            size_t group_tests;
+            size_t meshlet_tests;
+            size_t visible_meshlet_count;
+        };
+    private:
+        // inward facing and normalized: left, right, bottom, top, near, far
+        std::array<glm::vec4, 6> _planes;
+        glm::vec3 _camera_position;
+
+        [[nodiscard]] bool is_sphere_outside(const glm::vec3& center, float radius) const noexcept;
+        [[nodiscard]] bool is_meshlet_visible(const mesh::meshlet_bounds& bounds, bool test_frustum) const noexcept;
+    public:
+        // view_projection maps to D3D clip space, 0 <= z <= w, with either depth direction
+        meshlet_culler(const glm::mat4& view_projection, const glm::vec3& camera_position) noexcept;
+
+        // visible_meshlets receives the indices of the meshlets that pass, in order
+        result cull(const mesh& mesh, bool use_groups, std::vector<uint32_t>& visible_meshlets) const noexcept;
+
+        // every meshlet of meshlet_bounds, which must not include the padding
+        result cull(std::span<const mesh::meshlet_bounds> meshlet_bounds, std::vector<uint32_t>& visible_meshlets) const noexcept;
+
+        // Walks a BVH from build_meshlet_bvh testing four child boxes at a time with SSE. Subtrees whose box is inside the
+        // frustum skip the frustum tests below them; their meshlets only get the cone test.
+        result cull(std::span<const mesh::meshlet_bvh_node> nodes, std::span<const mesh::meshlet_bounds> meshlet_bounds,
+                    std::vector<uint32_t>& visible_meshlets) const noexcept;
+    };
+}
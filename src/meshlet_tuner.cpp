@@ -0,0 +1,189 @@
+#include "meshlet_tuner.hpp"
+#include "meshlet_builder.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <limits>
+#include <string>
+
+namespace d3d12_mesh_shaders {
+    static const std::array<uint32_t, 3> _VERTEX_LIMITS = { 32, 64, 128 };
+    static const std::array<uint32_t, 3> _TRIANGLE_LIMITS = { 64, 124, 256 };
+    static const std::array<float, 3> _CONE_WEIGHTS = { 0.0f, 0.25f, 0.5f };
+
+    // cost model weights, in units of one vertex transform
+    static const double _MESHLET_COST = 16.0;
+    static const double _LANE_COST = 0.125;
+    static const double _VERTEX_COST = 1.0;
+    static const double _TRIANGLE_COST = 0.5;
+    static const double _RADIUS_WEIGHT = 4.0;
+
+    meshlet_tuner::meshlet_tuner(const std::vector<mesh::vertex>& vertices, const std::vector<std::span<const uint32_t>>& index_ranges) noexcept {
+        for(const auto max_vertices : _VERTEX_LIMITS) {
+            for(const auto max_triangles : _TRIANGLE_LIMITS) {
+                if(max_vertices > default_meshlet_config::max_vertices || max_triangles > default_meshlet_config::max_triangles) {
+                    continue;
+                }
+
+                for(const auto cone_weight : _CONE_WEIGHTS) {
+                    _candidates.emplace_back().parameters = mesh::meshlet_parameters {
+                        .max_vertices = max_vertices,
+                        .max_triangles = max_triangles,
+                        .cone_weight = cone_weight,
+                        .clusterizer = mesh::meshlet_clusterizer::greedy
+                    };
+                }
+
+                // cone_weight means nothing to the graph clusterizer
+                _candidates.emplace_back().parameters = mesh::meshlet_parameters {
+                    .max_vertices = max_vertices,
+                    .max_triangles = max_triangles,
+                    .cone_weight = 0.0f,
+                    .clusterizer = mesh::meshlet_clusterizer::graph
+                };
+            }
+        }
+
+        std::vector<uint8_t> referenced(vertices.size(), 0);
+        auto min = glm::vec3(std::numeric_limits<float>::max()), max = glm::vec3(-std::numeric_limits<float>::max());
+
+        for(const auto& range : index_ranges) {
+            for(const auto index : range) {
+                referenced[index] = 1;
+                min = glm::min(min, vertices[index].position);
+                max = glm::max(max, vertices[index].position);
+            }
+        }
+
+        const auto referenced_count = std::max<size_t>(std::count(referenced.begin(), referenced.end(), 1), 1);
+        const auto extent = std::max(static_cast<double>(glm::max(max.x - min.x, glm::max(max.y - min.y, max.z - min.z))), 1e-30);
+
+        // threads per group are fixed by the compiled layout, whatever the meshlet actually holds
+        const auto group_lanes = static_cast<double>(std::max(default_meshlet_config::max_vertices, default_meshlet_config::max_triangles));
+
+        util::parallel_for(_candidates.size(), 1, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                auto& candidate = _candidates[i];
+
+                size_t vertex_references = 0;
+                double fill = 0.0, cull = 0.0, radius = 0.0, cost = 0.0;
+
+                meshlet_build build;
+                for(const auto& range : index_ranges) {
+                    build_meshlets(candidate.parameters, range.data(), range.size(), vertices, build);
+
+                    for(const auto& meshlet : build.meshlets) {
+                        const auto bounds = meshopt_computeMeshletBounds(build.vertices.data() + meshlet.vertex_offset, build.triangles.data() + meshlet.triangle_offset,
+                                                                         meshlet.triangle_count, &vertices[0].position.x, vertices.size(), sizeof(mesh::vertex));
+
+                        // a cone with cutoff c rejects the view directions v with dot(v, axis) >= c, (1 - c) / 2 of the sphere
+                        const auto meshlet_cull = (1.0 - std::min(static_cast<double>(bounds.cone_cutoff), 1.0)) * 0.5;
+                        const auto meshlet_radius = bounds.radius / extent;
+
+                        vertex_references += meshlet.vertex_count;
+                        fill += static_cast<double>(meshlet.triangle_count) / candidate.parameters.max_triangles;
+                        cull += meshlet_cull;
+                        radius += meshlet_radius;
+
+                        const auto work = meshlet.vertex_count * _VERTEX_COST + meshlet.triangle_count * _TRIANGLE_COST;
+                        cost += _MESHLET_COST + group_lanes * _LANE_COST + (1.0 - meshlet_cull) * (1.0 + _RADIUS_WEIGHT * meshlet_radius) * work;
+                    }
+
+                    candidate.meshlet_count += build.meshlets.size();
+                }
+
+                const auto meshlet_count = static_cast<double>(std::max<size_t>(candidate.meshlet_count, 1));
+
+                candidate.vertex_duplication = static_cast<double>(vertex_references) / static_cast<double>(referenced_count);
+                candidate.fill_ratio = fill / meshlet_count;
+                candidate.cull_fraction = cull / meshlet_count;
+                candidate.radius = radius / meshlet_count;
+                candidate.cost = cost;
+            }
+        });
+
+        _best = 0;
+        for(size_t i = 1; i < _candidates.size(); i++) {
+            if(_candidates[i].cost < _candidates[_best].cost) {
+                _best = i;
+            }
+        }
+    }
+
+    bool meshlet_tuner::load(const std::string_view& path, mesh::meshlet_parameters& parameters) noexcept {
+        std::ifstream file { std::string(path) };
+        if(!file) {
+            return false;
+        }
+
+        auto result = parameters;
+
+        // a failed extraction would otherwise just end the key loop and hand back half the file
+        const auto read_value = [&](auto& value) noexcept {
+            if(!(file >> value)) {
+                util::panic("meshlet_tuner: malformed value in tuning file");
+            }
+        };
+
+        std::string key;
+        while(file >> key) {
+            if(key == "max_vertices") {
+                read_value(result.max_vertices);
+            } else if(key == "max_triangles") {
+                read_value(result.max_triangles);
+            } else if(key == "cone_weight") {
+                read_value(result.cone_weight);
+            } else if(key == "clusterizer") {
+                std::string clusterizer;
+                read_value(clusterizer);
+
+                if(clusterizer == "greedy") {
+                    result.clusterizer = mesh::meshlet_clusterizer::greedy;
+                } else if(clusterizer == "graph") {
+                    result.clusterizer = mesh::meshlet_clusterizer::graph;
+                } else if(clusterizer == "scan") {
+                    result.clusterizer = mesh::meshlet_clusterizer::scan;
+                } else {
+                    util::panic("meshlet_tuner: unknown clusterizer in tuning file");
+                }
+            } else {
+                util::panic("meshlet_tuner: unknown key in tuning file");
+            }
+        }
+
+        if(std::find(_VERTEX_LIMITS.begin(), _VERTEX_LIMITS.end(), result.max_vertices) == _VERTEX_LIMITS.end()
+           || std::find(_TRIANGLE_LIMITS.begin(), _TRIANGLE_LIMITS.end(), result.max_triangles) == _TRIANGLE_LIMITS.end()) {
+            util::panic("meshlet_tuner: tuning file names an unsupported meshlet layout");
+        }
+
+        parameters = result;
+        return true;
+    }
+
+    void meshlet_tuner::save(const std::string_view& path, const mesh::meshlet_parameters& parameters) noexcept {
+        std::ofstream file { std::string(path) };
+        if(!file) {
+            util::panic("meshlet_tuner: cannot write tuning file");
+        }
+
+        file << "max_vertices " << parameters.max_vertices << '\n';
+        file << "max_triangles " << parameters.max_triangles << '\n';
+        file << "cone_weight " << parameters.cone_weight << '\n';
+
+        file << "clusterizer ";
+        switch(parameters.clusterizer) {
+            case mesh::meshlet_clusterizer::greedy:
+                file << "greedy";
+                break;
+            case mesh::meshlet_clusterizer::graph:
+                file << "graph";
+                break;
+            case mesh::meshlet_clusterizer::scan:
+                file << "scan";
+                break;
+        }
+        file << '\n';
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace d3d12_mesh_shaders {
+    // Builds the meshlets of a mesh for every layout that fits default_meshlet_config, with the greedy clusterizer at a few
+    // cone weights and with the graph clusterizer, and scores each build with a cost model of the per-frame mesh shader
+    // work: a fixed cost per meshlet plus the thread group lanes of the compiled layout, and the vertex and triangle work of
+    // the meshlet scaled by the share of view directions its normal cone cannot reject and by its relative bounding radius
+    // (loose spheres cull worse). The lowest cost wins.
+    class meshlet_tuner final {
+    public:
+        struct candidate final {
+            mesh::meshlet_parameters parameters;
+            size_t meshlet_count;
+            // meshlet vertex references per referenced vertex
+            double vertex_duplication;
+            // average triangle count over max_triangles
+            double fill_ratio;
+            // average share of view directions the normal cone rejects, 0.5 at most
+            double cull_fraction;
+            // average bounding sphere radius over the largest mesh extent
+            double radius;
+            double cost;
+        };
+    private:
+        std::vector<candidate> _candidates;
+        size_t _best;
+    public:
+        meshlet_tuner(const std::vector<mesh::vertex>& vertices, const std::vector<std::span<const uint32_t>>& index_ranges) noexcept;
+
+        [[nodiscard]] inline const std::vector<candidate>& get_candidates() const noexcept {
+            return _candidates;
+        }
+
+        [[nodiscard]] inline const candidate& get_best() const noexcept {
+            return _candidates[_best];
+        }
+
+        [[nodiscard]] static bool load(const std::string_view& path, mesh::meshlet_parameters& parameters) noexcept;
+        static void save(const std::string_view& path, const mesh::meshlet_parameters& parameters) noexcept;
+    };
+}
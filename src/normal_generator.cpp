@@ -0,0 +1,123 @@
+#include "normal_generator.hpp"
+#include "util.hpp"
+
+#include <meshoptimizer/meshoptimizer.h>
+
+#include <immintrin.h>
+
+namespace d3d12_mesh_shaders {
+    static const size_t _TRIANGLE_BATCH_SIZE = 1 << 14;
+    static const size_t _VERTEX_BATCH_SIZE = 1 << 14;
+
+    // mesh::vertex keeps tex_coord right behind position, so a 16 byte load starting at the position never leaves the
+    // vertex. The fourth lane is garbage and gets masked off wherever it could leak into a result.
+    static inline __m128 load_position(const mesh::vertex& vertex) noexcept {
+        return _mm_loadu_ps(&vertex.position.x);
+    }
+
+    static inline __m128 cross(const __m128 a, const __m128 b) noexcept {
+        const auto a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+        const auto b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+        const auto c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+        return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+    }
+
+    // expects a zero w lane, the result is broadcast to all lanes
+    static inline __m128 dot(const __m128 a, const __m128 b) noexcept {
+        const auto product = _mm_mul_ps(a, b);
+        const auto sum = _mm_add_ps(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    }
+
+    size_t generate_missing_normals(std::vector<mesh::vertex>& vertices, const std::vector<uint32_t>& indices) noexcept {
+        const auto vertex_count = vertices.size();
+        const auto index_count = indices.size();
+        const auto triangle_count = index_count / 3;
+
+        size_t missing_count = 0;
+        for(const auto& vertex : vertices) {
+            missing_count += vertex.normal == glm::vec3(0.0f);
+        }
+
+        if(missing_count == 0 || index_count == 0) {
+            return 0;
+        }
+
+        // Every corner is redirected to the first vertex with the same position, which is where its triangle's normal
+        // gets accumulated. That way a UV seam does not split the normal.
+        std::vector<uint32_t> position_indices(index_count);
+        meshopt_generateShadowIndexBuffer(position_indices.data(), indices.data(), index_count, &vertices[0].position.x, vertex_count,
+                                          sizeof(glm::vec3), sizeof(mesh::vertex));
+
+        const auto xyz_mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+
+        // The unnormalized cross product is twice the triangle area long, which gives the area weighting for free. The
+        // normals are stored as glm::vec4, since a vector of __m128 drops the type's alignment attribute.
+        std::vector<glm::vec4> face_normals(triangle_count);
+        util::parallel_for(triangle_count, _TRIANGLE_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                const auto a = load_position(vertices[indices[i * 3]]);
+                const auto b = load_position(vertices[indices[i * 3 + 1]]);
+                const auto c = load_position(vertices[indices[i * 3 + 2]]);
+
+                _mm_storeu_ps(&face_normals[i].x, _mm_and_ps(cross(_mm_sub_ps(b, a), _mm_sub_ps(c, a)), xyz_mask));
+            }
+        });
+
+        // position -> incident triangles, as offsets into one flat array
+        std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+        for(const auto position_index : position_indices) {
+            adjacency_offsets[position_index + 1]++;
+        }
+
+        for(size_t i = 0; i < vertex_count; i++) {
+            adjacency_offsets[i + 1] += adjacency_offsets[i];
+        }
+
+        std::vector<uint32_t> adjacency(index_count);
+        std::vector<uint32_t> vertex_positions(vertex_count, ~0u);
+        {
+            auto fill_offsets = adjacency_offsets;
+            for(size_t i = 0; i < index_count; i++) {
+                adjacency[fill_offsets[position_indices[i]]++] = static_cast<uint32_t>(i / 3);
+                vertex_positions[indices[i]] = position_indices[i];
+            }
+        }
+
+        std::vector<glm::vec3> position_normals(vertex_count);
+        util::parallel_for(vertex_count, _VERTEX_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                if(adjacency_offsets[i] == adjacency_offsets[i + 1]) {
+                    continue;
+                }
+
+                auto normal = _mm_setzero_ps();
+                for(auto j = adjacency_offsets[i]; j < adjacency_offsets[i + 1]; j++) {
+                    normal = _mm_add_ps(normal, _mm_loadu_ps(&face_normals[adjacency[j]].x));
+                }
+
+                const auto length_squared = dot(normal, normal);
+                if(_mm_cvtss_f32(length_squared) <= 0.0f) {
+                    position_normals[i] = glm::vec3(0.0f, 0.0f, 1.0f);
+                    continue;
+                }
+
+                alignas(16) float result[4];
+                _mm_store_ps(result, _mm_div_ps(normal, _mm_sqrt_ps(length_squared)));
+
+                position_normals[i] = glm::vec3(result[0], result[1], result[2]);
+            }
+        });
+
+        util::parallel_for(vertex_count, _VERTEX_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                auto& vertex = vertices[i];
+                if(vertex.normal == glm::vec3(0.0f)) {
+                    vertex.normal = vertex_positions[i] != ~0u ? position_normals[vertex_positions[i]] : glm::vec3(0.0f, 0.0f, 1.0f);
+                }
+            }
+        });
+
+        return missing_count;
+    }
+}
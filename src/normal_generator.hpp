@@ -0,0 +1,13 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace d3d12_mesh_shaders {
+    // Synthesizes normals for every vertex whose normal is zero, which is how the loaders mark missing source normals.
+    // Face normals are area weighted and accumulated over all vertices sharing a position, so UV seams stay smooth.
+    // Returns the number of vertices that received a generated normal.
+    size_t generate_missing_normals(std::vector<mesh::vertex>& vertices, const std::vector<uint32_t>& indices) noexcept;
+}
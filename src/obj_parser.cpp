@@ -0,0 +1,516 @@
+#include "obj_parser.hpp"
+#include "mapped_file.hpp"
+#include "util.hpp"
+
+#include <cstring>
+
+namespace d3d12_mesh_shaders {
+    static const size_t _MIN_CHUNK_SIZE = 1 << 20;
+    static const size_t _CHUNKS_PER_THREAD = 4;
+
+    static const uint32_t _INHERITED_MATERIAL = ~0u;
+
+    static const uint32_t _RELATIVE_POSITION = 1;
+    static const uint32_t _RELATIVE_TEX_COORD = 2;
+    static const uint32_t _RELATIVE_NORMAL = 4;
+
+    // Same tables and the same double accumulation as fast_obj, so every float comes out bit-identical.
+    static const uint32_t _MAX_POWER = 20;
+
+    static const double _POWER_10_POS[_MAX_POWER] = {
+        1.0e0,  1.0e1,  1.0e2,  1.0e3,  1.0e4,  1.0e5,  1.0e6,  1.0e7,  1.0e8,  1.0e9,
+        1.0e10, 1.0e11, 1.0e12, 1.0e13, 1.0e14, 1.0e15, 1.0e16, 1.0e17, 1.0e18, 1.0e19
+    };
+
+    static const double _POWER_10_NEG[_MAX_POWER] = {
+        1.0e0,   1.0e-1,  1.0e-2,  1.0e-3,  1.0e-4,  1.0e-5,  1.0e-6,  1.0e-7,  1.0e-8,  1.0e-9,
+        1.0e-10, 1.0e-11, 1.0e-12, 1.0e-13, 1.0e-14, 1.0e-15, 1.0e-16, 1.0e-17, 1.0e-18, 1.0e-19
+    };
+
+    enum class record_type {
+        group,
+        material_library,
+        use_material
+    };
+
+    struct record final {
+        record_type type;
+        std::string name;
+        uint32_t face_offset;
+        uint32_t index_offset;
+    };
+
+    struct relative_index final {
+        uint32_t index;
+        uint32_t mask;
+    };
+
+    // Everything one worker produced. Negative (relative) indices can only be resolved once the number of elements in all
+    // previous chunks is known, and g/usemtl/mtllib have to be replayed in file order, so both are deferred to the merge.
+    struct chunk final {
+        std::vector<float> positions;
+        std::vector<float> tex_coords;
+        std::vector<float> normals;
+
+        std::vector<uint32_t> face_vertices;
+        std::vector<uint32_t> face_materials;
+        std::vector<obj_parser::index> indices;
+        std::vector<relative_index> relative_indices;
+
+        std::vector<record> records;
+        uint32_t num_material_slots;
+    };
+
+    static inline bool is_whitespace(char c) noexcept {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    static inline bool is_end_of_name(char c) noexcept {
+        return c == '\t' || c == '\r' || c == '\n';
+    }
+
+    static inline bool is_newline(char c) noexcept {
+        return c == '\n';
+    }
+
+    static inline bool is_digit(char c) noexcept {
+        return c >= '0' && c <= '9';
+    }
+
+    static inline bool is_exponent(char c) noexcept {
+        return c == 'e' || c == 'E';
+    }
+
+    static inline const char* skip_whitespace(const char* ptr) noexcept {
+        while(is_whitespace(*ptr)) {
+            ptr++;
+        }
+
+        return ptr;
+    }
+
+    static inline const char* skip_line(const char* ptr) noexcept {
+        while(!is_newline(*ptr++));
+
+        return ptr;
+    }
+
+    static const char* parse_int(const char* ptr, int& value) noexcept {
+        int sign = 1;
+        if(*ptr == '-') {
+            sign = -1;
+            ptr++;
+        }
+
+        int num = 0;
+        while(is_digit(*ptr)) {
+            num = 10 * num + (*ptr++ - '0');
+        }
+
+        value = sign * num;
+        return ptr;
+    }
+
+    static const char* parse_float(const char* ptr, float& value) noexcept {
+        ptr = skip_whitespace(ptr);
+
+        double sign = 1.0;
+        if(*ptr == '+') {
+            ptr++;
+        } else if(*ptr == '-') {
+            sign = -1.0;
+            ptr++;
+        }
+
+        double num = 0.0;
+        while(is_digit(*ptr)) {
+            num = 10.0 * num + static_cast<double>(*ptr++ - '0');
+        }
+
+        if(*ptr == '.') {
+            ptr++;
+        }
+
+        double fra = 0.0, div = 1.0;
+        while(is_digit(*ptr)) {
+            fra = 10.0 * fra + static_cast<double>(*ptr++ - '0');
+            div *= 10.0;
+        }
+
+        num += fra / div;
+
+        if(is_exponent(*ptr)) {
+            ptr++;
+
+            const double* powers = _POWER_10_POS;
+            if(*ptr == '+') {
+                ptr++;
+            } else if(*ptr == '-') {
+                powers = _POWER_10_NEG;
+                ptr++;
+            }
+
+            uint32_t exponent = 0;
+            while(is_digit(*ptr)) {
+                exponent = 10 * exponent + (*ptr++ - '0');
+            }
+
+            num *= exponent >= _MAX_POWER ? 0.0 : powers[exponent];
+        }
+
+        value = static_cast<float>(sign * num);
+        return ptr;
+    }
+
+    static const char* parse_floats(const char* ptr, size_t count, std::vector<float>& values) noexcept {
+        for(size_t i = 0; i < count; i++) {
+            float value;
+            ptr = parse_float(ptr, value);
+            values.push_back(value);
+        }
+
+        return ptr;
+    }
+
+    static const char* parse_name(const char* ptr, std::string& name) noexcept {
+        ptr = skip_whitespace(ptr);
+
+        const auto* start = ptr;
+        while(!is_end_of_name(*ptr)) {
+            ptr++;
+        }
+
+        name.assign(start, ptr);
+        return ptr;
+    }
+
+    static inline uint32_t resolve_index(int value, size_t count, uint32_t flag, uint32_t& mask) noexcept {
+        if(value < 0) {
+            mask |= flag;
+            return static_cast<uint32_t>(count) - static_cast<uint32_t>(-value);
+        }
+
+        return static_cast<uint32_t>(value);
+    }
+
+    static const char* parse_face(chunk& chunk, uint32_t material_slot, const char* ptr) noexcept {
+        ptr = skip_whitespace(ptr);
+
+        uint32_t count = 0;
+        while(!is_newline(*ptr)) {
+            const auto* start = ptr;
+
+            int p = 0, t = 0, n = 0;
+            ptr = parse_int(ptr, p);
+            if(*ptr == '/') {
+                ptr++;
+                if(*ptr != '/') {
+                    ptr = parse_int(ptr, t);
+                }
+
+                if(*ptr == '/') {
+                    ptr++;
+                    ptr = parse_int(ptr, n);
+                }
+            }
+
+            uint32_t mask = 0;
+            const obj_parser::index index = {
+                .p = resolve_index(p, chunk.positions.size() / 3, _RELATIVE_POSITION, mask),
+                .t = resolve_index(t, chunk.tex_coords.size() / 2, _RELATIVE_TEX_COORD, mask),
+                .n = resolve_index(n, chunk.normals.size() / 3, _RELATIVE_NORMAL, mask)
+            };
+
+            if(mask) {
+                chunk.relative_indices.push_back({ static_cast<uint32_t>(chunk.indices.size()), mask });
+            }
+
+            chunk.indices.push_back(index);
+            count++;
+
+            ptr = skip_whitespace(ptr);
+
+            // fast_obj spins forever on garbage inside a face, bail out of the line instead
+            if(ptr == start) {
+                break;
+            }
+        }
+
+        chunk.face_vertices.push_back(count);
+        chunk.face_materials.push_back(material_slot);
+
+        return ptr;
+    }
+
+    static void push_record(chunk& chunk, record_type type, std::string&& name) noexcept {
+        chunk.records.push_back({
+            .type = type,
+            .name = std::move(name),
+            .face_offset = static_cast<uint32_t>(chunk.face_vertices.size()),
+            .index_offset = static_cast<uint32_t>(chunk.indices.size())
+        });
+    }
+
+    // Mirrors parse_buffer from fast_obj. ptr..end has to consist of whole, '\n' terminated lines.
+    static void parse_chunk(chunk& chunk, uint32_t& material_slot, const char* ptr, const char* end) noexcept {
+        std::string name;
+
+        while(ptr != end) {
+            ptr = skip_whitespace(ptr);
+
+            switch(*ptr) {
+                case 'v':
+                    ptr++;
+
+                    switch(*ptr++) {
+                        case ' ':
+                        case '\t':
+                            ptr = parse_floats(ptr, 3, chunk.positions);
+                            break;
+                        case 't':
+                            ptr = parse_floats(ptr, 2, chunk.tex_coords);
+                            break;
+                        case 'n':
+                            ptr = parse_floats(ptr, 3, chunk.normals);
+                            break;
+                        default:
+                            ptr--;
+                    }
+                    break;
+                case 'f':
+                    ptr++;
+
+                    switch(*ptr++) {
+                        case ' ':
+                        case '\t':
+                            ptr = parse_face(chunk, material_slot, ptr);
+                            break;
+                        default:
+                            ptr--;
+                    }
+                    break;
+                case 'g':
+                    ptr++;
+
+                    switch(*ptr++) {
+                        case ' ':
+                        case '\t':
+                            ptr = parse_name(ptr, name);
+                            push_record(chunk, record_type::group, std::move(name));
+                            break;
+                        default:
+                            ptr--;
+                    }
+                    break;
+                case 'm':
+                    ptr++;
+                    if(ptr[0] == 't' && ptr[1] == 'l' && ptr[2] == 'l' && ptr[3] == 'i' && ptr[4] == 'b' && is_whitespace(ptr[5])) {
+                        ptr = parse_name(ptr + 5, name);
+                        push_record(chunk, record_type::material_library, std::move(name));
+                    }
+                    break;
+                case 'u':
+                    ptr++;
+                    if(ptr[0] == 's' && ptr[1] == 'e' && ptr[2] == 'm' && ptr[3] == 't' && ptr[4] == 'l' && is_whitespace(ptr[5])) {
+                        ptr = parse_name(ptr + 5, name);
+                        push_record(chunk, record_type::use_material, std::move(name));
+                        material_slot = chunk.num_material_slots++;
+                    }
+                    break;
+            }
+
+            ptr = skip_line(ptr);
+        }
+    }
+
+    // Only the newmtl names are needed to hand out the same material indices as fast_obj.
+    static size_t read_material_library(const std::string& path, std::vector<std::string>& materials) noexcept {
+        const mapped_file file(path);
+        if(!file.is_open()) {
+            return 0;
+        }
+
+        std::string contents(file.get_data(), file.get_size());
+        contents.push_back('\n');
+
+        const auto* ptr = contents.data();
+        const auto* end = ptr + contents.size();
+
+        while(ptr < end) {
+            ptr = skip_whitespace(ptr);
+
+            if(ptr[0] == 'n' && ptr[1] == 'e' && ptr[2] == 'w' && ptr[3] == 'm' && ptr[4] == 't' && ptr[5] == 'l' && is_whitespace(ptr[6])) {
+                ptr = skip_whitespace(ptr + 6);
+
+                const auto* start = ptr;
+                while(!is_end_of_name(*ptr)) {
+                    ptr++;
+                }
+
+                materials.emplace_back(start, ptr);
+            }
+
+            ptr = skip_line(ptr);
+        }
+
+        return file.get_size();
+    }
+
+    obj_parser::obj_parser(const std::string_view& path) noexcept {
+        const mapped_file file(path);
+        if(!file.is_open()) {
+            util::panic("mapped_file");
+        }
+
+        _source_bytes = file.get_size();
+
+        const auto* data = file.get_data();
+        const auto size = file.get_size();
+
+        // Everything up to the last newline is split between the workers. A last line without a newline gets a terminated
+        // copy and is parsed by whoever owns the final chunk.
+        auto body_size = size;
+        while(body_size && data[body_size - 1] != '\n') {
+            body_size--;
+        }
+
+        const std::string tail = size != body_size ? std::string(data + body_size, size - body_size) + '\n' : std::string();
+
+        const auto max_chunks = util::get_num_worker_threads() * _CHUNKS_PER_THREAD;
+        const auto num_chunks = size ? std::clamp<size_t>(body_size / _MIN_CHUNK_SIZE, 1, max_chunks) : 0;
+
+        std::vector<size_t> chunk_offsets(num_chunks + 1, body_size);
+        chunk_offsets[0] = 0;
+
+        for(size_t i = 1; i < num_chunks; i++) {
+            const auto offset = std::max(i * body_size / num_chunks, chunk_offsets[i - 1]);
+            const auto* newline = static_cast<const char*>(memchr(data + offset, '\n', body_size - offset));
+            chunk_offsets[i] = newline ? static_cast<size_t>(newline - data) + 1 : body_size;
+        }
+
+        std::vector<chunk> chunks(num_chunks);
+
+        util::parallel_for(num_chunks, 1, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                auto& chunk = chunks[i];
+                chunk.num_material_slots = 0;
+
+                auto material_slot = _INHERITED_MATERIAL;
+                parse_chunk(chunk, material_slot, data + chunk_offsets[i], data + chunk_offsets[i + 1]);
+
+                if(i + 1 == num_chunks && !tail.empty()) {
+                    parse_chunk(chunk, material_slot, tail.data(), tail.data() + tail.size());
+                }
+            }
+        });
+
+        // Replay groups and materials in file order and lay out where every chunk lands in the final arrays. Element 0 of
+        // every attribute array is the dummy fast_obj adds in front.
+        std::vector<size_t> position_offsets(num_chunks + 1, 3), tex_coord_offsets(num_chunks + 1, 2), normal_offsets(num_chunks + 1, 3);
+        std::vector<size_t> face_offsets(num_chunks + 1, 0), index_offsets(num_chunks + 1, 0);
+
+        std::vector<uint32_t> chunk_materials(num_chunks);
+        std::vector<std::vector<uint32_t>> material_slots(num_chunks);
+
+        std::string base_path(path.substr(0, path.find_last_of("/\\") + 1));
+
+        uint32_t current_material = 0;
+        group current_group = {};
+
+        for(size_t i = 0; i < num_chunks; i++) {
+            const auto& chunk = chunks[i];
+
+            position_offsets[i + 1] = position_offsets[i] + chunk.positions.size();
+            tex_coord_offsets[i + 1] = tex_coord_offsets[i] + chunk.tex_coords.size();
+            normal_offsets[i + 1] = normal_offsets[i] + chunk.normals.size();
+            face_offsets[i + 1] = face_offsets[i] + chunk.face_vertices.size();
+            index_offsets[i + 1] = index_offsets[i] + chunk.indices.size();
+
+            chunk_materials[i] = current_material;
+            material_slots[i].reserve(chunk.num_material_slots);
+
+            for(const auto& record : chunk.records) {
+                const auto face_offset = static_cast<uint32_t>(face_offsets[i] + record.face_offset);
+
+                switch(record.type) {
+                    case record_type::group:
+                        current_group.face_count = face_offset - current_group.face_offset;
+                        if(current_group.face_count) {
+                            _groups.push_back(std::move(current_group));
+                        }
+
+                        current_group = {
+                            .name = record.name,
+                            .face_count = 0,
+                            .face_offset = face_offset,
+                            .index_offset = static_cast<uint32_t>(index_offsets[i] + record.index_offset)
+                        };
+                        break;
+                    case record_type::material_library:
+                        _source_bytes += read_material_library(base_path + record.name, _materials);
+                        break;
+                    case record_type::use_material:
+                        current_material = static_cast<uint32_t>(std::find(_materials.begin(), _materials.end(), record.name) - _materials.begin());
+                        if(current_material == _materials.size()) {
+                            _materials.push_back(record.name);
+                        }
+
+                        material_slots[i].push_back(current_material);
+                        break;
+                }
+            }
+        }
+
+        current_group.face_count = static_cast<uint32_t>(face_offsets[num_chunks]) - current_group.face_offset;
+        if(current_group.face_count) {
+            _groups.push_back(std::move(current_group));
+        }
+
+        _positions.resize(position_offsets[num_chunks]);
+        _tex_coords.resize(tex_coord_offsets[num_chunks]);
+        _normals.resize(normal_offsets[num_chunks]);
+        _face_vertices.resize(face_offsets[num_chunks]);
+        _face_materials.resize(face_offsets[num_chunks]);
+        _indices.resize(index_offsets[num_chunks]);
+
+        std::fill_n(_positions.begin(), 3, 0.0f);
+        std::fill_n(_tex_coords.begin(), 2, 0.0f);
+        _normals[0] = 0.0f;
+        _normals[1] = 0.0f;
+        _normals[2] = 1.0f;
+
+        util::parallel_for(num_chunks, 1, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                auto chunk = std::move(chunks[i]);
+
+                std::copy(chunk.positions.begin(), chunk.positions.end(), _positions.begin() + position_offsets[i]);
+                std::copy(chunk.tex_coords.begin(), chunk.tex_coords.end(), _tex_coords.begin() + tex_coord_offsets[i]);
+                std::copy(chunk.normals.begin(), chunk.normals.end(), _normals.begin() + normal_offsets[i]);
+                std::copy(chunk.face_vertices.begin(), chunk.face_vertices.end(), _face_vertices.begin() + face_offsets[i]);
+
+                for(auto& relative_index : chunk.relative_indices) {
+                    auto& index = chunk.indices[relative_index.index];
+
+                    if(relative_index.mask & _RELATIVE_POSITION) {
+                        index.p += static_cast<uint32_t>(position_offsets[i] / 3);
+                    }
+
+                    if(relative_index.mask & _RELATIVE_TEX_COORD) {
+                        index.t += static_cast<uint32_t>(tex_coord_offsets[i] / 2);
+                    }
+
+                    if(relative_index.mask & _RELATIVE_NORMAL) {
+                        index.n += static_cast<uint32_t>(normal_offsets[i] / 3);
+                    }
+                }
+
+                std::copy(chunk.indices.begin(), chunk.indices.end(), _indices.begin() + index_offsets[i]);
+
+                for(size_t j = 0; j < chunk.face_materials.size(); j++) {
+                    const auto material_slot = chunk.face_materials[j];
+                    _face_materials[face_offsets[i] + j] = material_slot == _INHERITED_MATERIAL ? chunk_materials[i] : material_slots[i][material_slot];
+                }
+            }
+        });
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace d3d12_mesh_shaders {
+    // Multi-threaded replacement for fast_obj_read. The source is split at line boundaries, every chunk is parsed on its own
+    // worker and the chunks are stitched together afterwards, so the arrays come out exactly like the ones of fastObjMesh
+    // (including the dummy position/tex_coord/normal at index 0). Materials are only tracked by name.
+    class obj_parser final {
+    public:
+        struct index final {
+            uint32_t p;
+            uint32_t t;
+            uint32_t n;
+        };
+
+        struct group final {
+            std::string name;
+            uint32_t face_count;
+            uint32_t face_offset;
+            uint32_t index_offset;
+        };
+    private:
+        std::vector<float> _positions;
+        std::vector<float> _tex_coords;
+        std::vector<float> _normals;
+
+        std::vector<uint32_t> _face_vertices;
+        std::vector<uint32_t> _face_materials;
+        std::vector<index> _indices;
+
+        std::vector<std::string> _materials;
+        std::vector<group> _groups;
+
+        size_t _source_bytes;
+
+    public:
+        obj_parser(const std::string_view& path) noexcept;
+
+        [[nodiscard]] inline const std::vector<float>& get_positions() const noexcept {
+            return _positions;
+        }
+
+        [[nodiscard]] inline const std::vector<float>& get_tex_coords() const noexcept {
+            return _tex_coords;
+        }
+
+        [[nodiscard]] inline const std::vector<float>& get_normals() const noexcept {
+            return _normals;
+        }
+
+        [[nodiscard]] inline const std::vector<uint32_t>& get_face_vertices() const noexcept {
+            return _face_vertices;
+        }
+
+        [[nodiscard]] inline const std::vector<uint32_t>& get_face_materials() const noexcept {
+            return _face_materials;
+        }
+
+        [[nodiscard]] inline const std::vector<index>& get_indices() const noexcept {
+            return _indices;
+        }
+
+        [[nodiscard]] inline const std::vector<std::string>& get_materials() const noexcept {
+            return _materials;
+        }
+
+        [[nodiscard]] inline const std::vector<group>& get_groups() const noexcept {
+            return _groups;
+        }
+
+        [[nodiscard]] inline size_t get_source_bytes() const noexcept {
+            return _source_bytes;
+        }
+    };
+}
@@ -0,0 +1,360 @@
+#include "ply_parser.hpp"
+#include "mapped_file.hpp"
+#include "util.hpp"
+
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <string>
+
+namespace d3d12_mesh_shaders {
+    static const size_t _VERTEX_BATCH_SIZE = 1 << 16;
+
+    enum class property_type {
+        int8,
+        uint8,
+        int16,
+        uint16,
+        int32,
+        uint32,
+        float32,
+        float64
+    };
+
+    struct property final {
+        std::string name;
+        property_type type;
+        property_type count_type;
+        bool is_list;
+        size_t offset;
+    };
+
+    struct element final {
+        std::string name;
+        size_t count;
+        std::vector<property> properties;
+        size_t stride;
+        bool has_lists;
+    };
+
+    static bool parse_property_type(const std::string_view& name, property_type& type) noexcept {
+        if(name == "char" || name == "int8") type = property_type::int8;
+        else if(name == "uchar" || name == "uint8") type = property_type::uint8;
+        else if(name == "short" || name == "int16") type = property_type::int16;
+        else if(name == "ushort" || name == "uint16") type = property_type::uint16;
+        else if(name == "int" || name == "int32") type = property_type::int32;
+        else if(name == "uint" || name == "uint32") type = property_type::uint32;
+        else if(name == "float" || name == "float32") type = property_type::float32;
+        else if(name == "double" || name == "float64") type = property_type::float64;
+        else return false;
+
+        return true;
+    }
+
+    static inline size_t get_property_size(property_type type) noexcept {
+        switch(type) {
+            case property_type::int8:
+            case property_type::uint8:
+                return 1;
+            case property_type::int16:
+            case property_type::uint16:
+                return 2;
+            case property_type::int32:
+            case property_type::uint32:
+            case property_type::float32:
+                return 4;
+            case property_type::float64:
+                return 8;
+        }
+
+        return 0;
+    }
+
+    template<typename T>
+    static inline T read_unaligned(const char* data) noexcept {
+        T value;
+        memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    static inline float read_float(const char* data, property_type type) noexcept {
+        switch(type) {
+            case property_type::int8: return static_cast<float>(read_unaligned<int8_t>(data));
+            case property_type::uint8: return static_cast<float>(read_unaligned<uint8_t>(data));
+            case property_type::int16: return static_cast<float>(read_unaligned<int16_t>(data));
+            case property_type::uint16: return static_cast<float>(read_unaligned<uint16_t>(data));
+            case property_type::int32: return static_cast<float>(read_unaligned<int32_t>(data));
+            case property_type::uint32: return static_cast<float>(read_unaligned<uint32_t>(data));
+            case property_type::float32: return read_unaligned<float>(data);
+            case property_type::float64: return static_cast<float>(read_unaligned<double>(data));
+        }
+
+        return 0.0f;
+    }
+
+    static inline uint32_t read_uint(const char* data, property_type type) noexcept {
+        switch(type) {
+            case property_type::int8: return static_cast<uint32_t>(read_unaligned<int8_t>(data));
+            case property_type::uint8: return read_unaligned<uint8_t>(data);
+            case property_type::int16: return static_cast<uint32_t>(read_unaligned<int16_t>(data));
+            case property_type::uint16: return read_unaligned<uint16_t>(data);
+            case property_type::int32: return static_cast<uint32_t>(read_unaligned<int32_t>(data));
+            case property_type::uint32: return read_unaligned<uint32_t>(data);
+            case property_type::float32: return static_cast<uint32_t>(read_unaligned<float>(data));
+            case property_type::float64: return static_cast<uint32_t>(read_unaligned<double>(data));
+        }
+
+        return 0;
+    }
+
+    static std::vector<std::string_view> split_line(const std::string_view& line) noexcept {
+        std::vector<std::string_view> tokens;
+
+        size_t start = 0;
+        while(start < line.size()) {
+            const auto end = std::min(line.find_first_of(" \t\r", start), line.size());
+            if(end > start) {
+                tokens.push_back(line.substr(start, end - start));
+            }
+
+            start = end + 1;
+        }
+
+        return tokens;
+    }
+
+    static const element* find_element(const std::vector<element>& elements, const std::string_view& name) noexcept {
+        for(const auto& element : elements) {
+            if(element.name == name) {
+                return &element;
+            }
+        }
+
+        return nullptr;
+    }
+
+    static const property* find_property(const element& element, std::initializer_list<std::string_view> names) noexcept {
+        for(const auto& property : element.properties) {
+            for(const auto& name : names) {
+                if(!property.is_list && property.name == name) {
+                    return &property;
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
+    static size_t get_property_data_size(const property& property, const char* data, const char* end) noexcept {
+        if(!property.is_list) {
+            return get_property_size(property.type);
+        }
+
+        const auto count_size = get_property_size(property.count_type);
+        if(data + count_size > end) {
+            util::panic("ply_parser: truncated list");
+        }
+
+        return count_size + read_uint(data, property.count_type) * get_property_size(property.type);
+    }
+
+    // Size of one record of an element that contains lists, reading the list counts as it goes.
+    static size_t get_record_size(const element& element, const char* data, const char* end) noexcept {
+        size_t size = 0;
+        for(const auto& property : element.properties) {
+            size += get_property_data_size(property, data + size, end);
+        }
+
+        return size;
+    }
+
+    ply_parser::ply_parser(const std::string_view& path) noexcept {
+        const mapped_file file(path);
+        if(!file.is_open()) {
+            util::panic("mapped_file");
+        }
+
+        _source_bytes = file.get_size();
+
+        const std::string_view contents(file.get_data(), file.get_size());
+
+        const auto header_end = contents.find("end_header");
+        if(!contents.starts_with("ply") || header_end == std::string_view::npos) {
+            util::panic("ply_parser: not a ply file");
+        }
+
+        std::vector<element> elements;
+
+        size_t line_start = 0;
+        while(line_start < header_end) {
+            const auto line_end = contents.find('\n', line_start);
+            const auto tokens = split_line(contents.substr(line_start, line_end - line_start));
+            line_start = line_end + 1;
+
+            if(tokens.empty()) {
+                continue;
+            }
+
+            if(tokens[0] == "format") {
+                if(tokens.size() < 2 || tokens[1] != "binary_little_endian") {
+                    util::panic("ply_parser: only binary_little_endian is supported");
+                }
+            } else if(tokens[0] == "element" && tokens.size() >= 3) {
+                size_t count = 0;
+                std::from_chars(tokens[2].data(), tokens[2].data() + tokens[2].size(), count);
+
+                elements.push_back({
+                    .name = std::string(tokens[1]),
+                    .count = count,
+                    .properties = {},
+                    .stride = 0,
+                    .has_lists = false
+                });
+            } else if(tokens[0] == "property" && !elements.empty()) {
+                auto& element = elements.back();
+
+                property property = {
+                    .name = std::string(tokens.back()),
+                    .type = property_type::uint8,
+                    .count_type = property_type::uint8,
+                    .is_list = tokens.size() >= 5 && tokens[1] == "list",
+                    .offset = element.stride
+                };
+
+                const auto valid = property.is_list
+                    ? parse_property_type(tokens[2], property.count_type) && parse_property_type(tokens[3], property.type)
+                    : tokens.size() >= 3 && parse_property_type(tokens[1], property.type);
+
+                if(!valid) {
+                    util::panic("ply_parser: unknown property type");
+                }
+
+                element.has_lists |= property.is_list;
+                element.stride += property.is_list ? 0 : get_property_size(property.type);
+                element.properties.push_back(std::move(property));
+            }
+        }
+
+        const auto data_start = contents.find('\n', header_end);
+        if(data_start == std::string_view::npos) {
+            util::panic("ply_parser: truncated header");
+        }
+
+        const auto* data = file.get_data() + data_start + 1;
+        const auto* end = file.get_data() + file.get_size();
+
+        const auto* vertex_element = find_element(elements, "vertex");
+        const auto* face_element = find_element(elements, "face");
+        if(!vertex_element || !face_element || vertex_element->has_lists) {
+            util::panic("ply_parser: expected fixed-size vertex and face elements");
+        }
+
+        for(const auto& element : elements) {
+            if(&element == vertex_element) {
+                if(data + element.count * element.stride > end) {
+                    util::panic("ply_parser: truncated vertex data");
+                }
+
+                // Slots of mesh::vertex in declaration order: position, tex_coord, normal.
+                const std::array<const property*, 8> sources = {
+                    find_property(element, { "x" }),
+                    find_property(element, { "y" }),
+                    find_property(element, { "z" }),
+                    find_property(element, { "u", "s", "texture_u", "texture_s" }),
+                    find_property(element, { "v", "t", "texture_v", "texture_t" }),
+                    find_property(element, { "nx" }),
+                    find_property(element, { "ny" }),
+                    find_property(element, { "nz" })
+                };
+
+                if(!sources[0] || !sources[1] || !sources[2]) {
+                    util::panic("ply_parser: vertex element without x/y/z");
+                }
+
+                _vertices.resize(element.count);
+
+                const auto* vertex_data = data;
+                const auto stride = element.stride;
+
+                util::parallel_for(element.count, _VERTEX_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+                    for(auto i = begin; i < end; i++) {
+                        const auto* record = vertex_data + i * stride;
+
+                        std::array<float, 8> values;
+                        for(size_t j = 0; j < sources.size(); j++) {
+                            values[j] = sources[j] ? read_float(record + sources[j]->offset, sources[j]->type) : 0.0f;
+                        }
+
+                        _vertices[i] = mesh::vertex(glm::vec3(values[0], values[1], values[2]), glm::vec2(values[3], values[4]),
+                                                    glm::vec3(values[5], values[6], values[7]));
+                    }
+                });
+
+                data += element.count * element.stride;
+            } else if(&element == face_element) {
+                const property* index_property = nullptr;
+                for(const auto& property : element.properties) {
+                    if(property.is_list && (property.name == "vertex_indices" || property.name == "vertex_index")) {
+                        index_property = &property;
+                    }
+                }
+
+                if(!index_property) {
+                    util::panic("ply_parser: face element without vertex_indices");
+                }
+
+                const auto count_size = get_property_size(index_property->count_type);
+                const auto index_size = get_property_size(index_property->type);
+
+                // uchar count + int index triangles are by far the most common layout, so the index buffer gets sized
+                // for that up front and only grows for polygons.
+                _indices.reserve(element.count * 3);
+
+                for(size_t i = 0; i < element.count; i++) {
+                    for(const auto& property : element.properties) {
+                        if(&property != index_property) {
+                            data += get_property_data_size(property, data, end);
+                            continue;
+                        }
+
+                        if(data + count_size > end) {
+                            util::panic("ply_parser: truncated face data");
+                        }
+
+                        const auto count = read_uint(data, property.count_type);
+                        data += count_size;
+
+                        if(data + count * index_size > end) {
+                            util::panic("ply_parser: truncated face data");
+                        }
+
+                        const auto first = read_uint(data, property.type);
+                        for(uint32_t j = 2; j < count; j++) {
+                            _indices.push_back(first);
+                            _indices.push_back(read_uint(data + (j - 1) * index_size, property.type));
+                            _indices.push_back(read_uint(data + j * index_size, property.type));
+                        }
+
+                        data += count * index_size;
+                    }
+                }
+            } else if(element.has_lists) {
+                for(size_t i = 0; i < element.count; i++) {
+                    data += get_record_size(element, data, end);
+                }
+            } else {
+                data += element.count * element.stride;
+            }
+
+            if(data > end) {
+                util::panic("ply_parser: truncated file");
+            }
+        }
+
+        for(const auto index : _indices) {
+            if(index >= _vertices.size()) {
+                util::panic("ply_parser: vertex index out of range");
+            }
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace d3d12_mesh_shaders {
+    // Reader for binary little-endian PLY. Vertex properties are converted straight into mesh::vertex and face lists
+    // (any count/index type, polygons are fan triangulated) straight into an index buffer, nothing goes through text.
+    class ply_parser final {
+    private:
+        std::vector<mesh::vertex> _vertices;
+        std::vector<uint32_t> _indices;
+
+        size_t _source_bytes;
+
+    public:
+        ply_parser(const std::string_view& path) noexcept;
+
+        [[nodiscard]] inline std::vector<mesh::vertex>& get_vertices() noexcept {
+            return _vertices;
+        }
+
+        [[nodiscard]] inline std::vector<uint32_t>& get_indices() noexcept {
+            return _indices;
+        }
+
+        [[nodiscard]] inline size_t get_source_bytes() const noexcept {
+            return _source_bytes;
+        }
+    };
+}
@@ -0,0 +1,189 @@
+#include "scratch_arena.hpp"
+
+#include <meshoptimizer/meshoptimizer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <thread>
+
+namespace d3d12_mesh_shaders {
+    static const size_t _BLOCK_SIZE = 16 * 1024 * 1024;
+    static const size_t _ALIGNMENT = 64;
+
+    // Every allocation is preceded by a header holding the offset of the allocation below it, so rewinding the top one
+    // restores the one before as the new top.
+    static const size_t _HEADER_SIZE = _ALIGNMENT;
+    static const size_t _NO_ALLOCATION = ~size_t(0);
+
+    // blocks the pool keeps per hardware thread once they are returned, enough for the main thread and a parallel_for
+    static const size_t _POOLED_BLOCKS_PER_THREAD = 2;
+
+    struct pooled_block final {
+        uint8_t* data;
+        size_t size;
+    };
+
+    static std::mutex _pool_mutex;
+    static std::vector<pooled_block> _pool;
+    static size_t _pooled_bytes = 0;
+
+    static thread_local scratch_arena::scope* _current_scope = nullptr;
+
+    static pooled_block take_block(size_t min_size) noexcept {
+        {
+            std::lock_guard lock(_pool_mutex);
+
+            const auto it = std::find_if(_pool.begin(), _pool.end(), [min_size](const pooled_block& block) noexcept {
+                return block.size >= min_size;
+            });
+
+            if(it != _pool.end()) {
+                const auto block = *it;
+                _pool.erase(it);
+                _pooled_bytes -= block.size;
+                return block;
+            }
+        }
+
+        const auto size = std::max(min_size, _BLOCK_SIZE);
+        return pooled_block { static_cast<uint8_t*>(::operator new(size, std::align_val_t(_ALIGNMENT))), size };
+    }
+
+    static void return_block(uint8_t* data, size_t size) noexcept {
+        static const auto max_pooled_bytes = std::max<size_t>(std::thread::hardware_concurrency(), 1) * _POOLED_BLOCKS_PER_THREAD * _BLOCK_SIZE;
+
+        {
+            std::lock_guard lock(_pool_mutex);
+
+            if(_pooled_bytes + size <= max_pooled_bytes) {
+                _pool.push_back(pooled_block { data, size });
+                _pooled_bytes += size;
+                return;
+            }
+        }
+
+        ::operator delete(data, std::align_val_t(_ALIGNMENT));
+    }
+
+    static void* allocate_scratch(size_t size) noexcept {
+        return scratch_arena::get().allocate(size);
+    }
+
+    static void deallocate_scratch(void* pointer) noexcept {
+        scratch_arena::get().deallocate(pointer);
+    }
+
+    scratch_arena::~scratch_arena() noexcept {
+        release_blocks();
+    }
+
+    void scratch_arena::install() noexcept {
+        meshopt_setAllocator(allocate_scratch, deallocate_scratch);
+    }
+
+    scratch_arena& scratch_arena::get() noexcept {
+        thread_local scratch_arena arena;
+        return arena;
+    }
+
+    scratch_arena::scope::scope() noexcept : _previous(_current_scope) {
+        _current_scope = this;
+    }
+
+    scratch_arena::scope::~scope() noexcept {
+        scratch_arena::get().reset();
+        _current_scope = _previous;
+    }
+
+    void scratch_arena::scope::add_live_bytes(size_t size) noexcept {
+        _allocation_count.fetch_add(1, std::memory_order_relaxed);
+        const auto live = _live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+
+        auto peak = _peak_bytes.load(std::memory_order_relaxed);
+        while(live > peak && !_peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    }
+
+    void scratch_arena::scope::remove_live_bytes(size_t size) noexcept {
+        _live_bytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    scratch_arena::statistics scratch_arena::scope::get_statistics() const noexcept {
+        return statistics {
+            .allocation_count = _allocation_count.load(std::memory_order_relaxed),
+            .peak_bytes = _peak_bytes.load(std::memory_order_relaxed)
+        };
+    }
+
+    scratch_arena::scope* scratch_arena::scope::get_current() noexcept {
+        return _current_scope;
+    }
+
+    void scratch_arena::scope::set_current(scope* current) noexcept {
+        _current_scope = current;
+    }
+
+    void* scratch_arena::allocate(size_t size) noexcept {
+        const auto total_size = _HEADER_SIZE + (size + _ALIGNMENT - 1) / _ALIGNMENT * _ALIGNMENT;
+
+        if(_blocks.empty() || _blocks.back().owner != _current_scope || _blocks.back().size - _blocks.back().used < total_size) {
+            const auto pooled = take_block(total_size);
+            _blocks.push_back(block { pooled.data, pooled.size, 0, _NO_ALLOCATION, _current_scope });
+        }
+
+        auto& block = _blocks.back();
+        auto* header = block.data + block.used;
+
+        *reinterpret_cast<size_t*>(header) = block.top;
+        block.top = block.used;
+        block.used += total_size;
+
+        if(block.owner) {
+            block.owner->add_live_bytes(total_size);
+        }
+
+        return header + _HEADER_SIZE;
+    }
+
+    void scratch_arena::deallocate(void* pointer) noexcept {
+        if(_blocks.empty()) {
+            return;
+        }
+
+        auto& block = _blocks.back();
+
+        // only the most recent allocation can be rewound, everything older waits for reset()
+        const auto* header = static_cast<const uint8_t*>(pointer) - _HEADER_SIZE;
+        if(block.top == _NO_ALLOCATION || header != block.data + block.top) {
+            return;
+        }
+
+        if(block.owner) {
+            block.owner->remove_live_bytes(block.used - block.top);
+        }
+
+        block.used = block.top;
+        block.top = *reinterpret_cast<const size_t*>(header);
+
+        if(block.used == 0 && _blocks.size() > 1) {
+            return_block(block.data, block.size);
+            _blocks.pop_back();
+        }
+    }
+
+    void scratch_arena::reset() noexcept {
+        release_blocks();
+    }
+
+    void scratch_arena::release_blocks() noexcept {
+        for(const auto& block : _blocks) {
+            if(block.owner) {
+                block.owner->remove_live_bytes(block.used);
+            }
+            return_block(block.data, block.size);
+        }
+
+        _blocks.clear();
+    }
+}
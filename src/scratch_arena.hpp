@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace d3d12_mesh_shaders {
+    // Per-thread bump allocator that meshoptimizer's scratch memory is routed through. meshoptimizer releases its
+    // temporaries in reverse order, so freeing the most recent allocation rewinds the arena; anything else is reclaimed by
+    // reset(). Blocks come from a process-wide pool and go back to it on reset or thread exit, so the pages stay committed
+    // from one mesh build to the next instead of being faulted in again; the pool keeps a few blocks per hardware thread
+    // and frees the rest. Only meshoptimizer's scratch goes through it: the std::vector temporaries of the build passes
+    // (remap tables, per-chunk meshlet builds, sort buffers) grow and shrink in no particular order and stay on the heap.
+    class scratch_arena final {
+    public:
+        struct statistics final {
+            size_t allocation_count;
+            size_t peak_bytes;
+        };
+
+        // Counts the scratch of one build. Constructing a scope makes it current on the calling thread, and parallel_for
+        // carries the current scope into its workers, so builds running side by side keep their counts apart. The calling
+        // thread's arena is reset when the scope ends.
+        class scope final {
+            std::atomic<size_t> _allocation_count = 0;
+            std::atomic<size_t> _live_bytes = 0;
+            std::atomic<size_t> _peak_bytes = 0;
+            scope* _previous;
+
+            void add_live_bytes(size_t size) noexcept;
+            void remove_live_bytes(size_t size) noexcept;
+
+            friend class scratch_arena;
+        public:
+            scope() noexcept;
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+            ~scope() noexcept;
+
+            [[nodiscard]] statistics get_statistics() const noexcept;
+
+            [[nodiscard]] static scope* get_current() noexcept;
+            static void set_current(scope* current) noexcept;
+        };
+    private:
+        // every allocation in a block is counted against the scope the block was taken for
+        struct block final {
+            uint8_t* data;
+            size_t size;
+            size_t used;
+            size_t top;
+            scope* owner;
+        };
+
+        std::vector<block> _blocks;
+
+        scratch_arena() noexcept = default;
+
+        void release_blocks() noexcept;
+    public:
+        scratch_arena(const scratch_arena&) = delete;
+        scratch_arena& operator=(const scratch_arena&) = delete;
+
+        ~scratch_arena() noexcept;
+
+        // Points meshopt_setAllocator at the calling thread's arena. Safe to call more than once.
+        static void install() noexcept;
+
+        [[nodiscard]] static scratch_arena& get() noexcept;
+
+        [[nodiscard]] void* allocate(size_t size) noexcept;
+        void deallocate(void* pointer) noexcept;
+
+        void reset() noexcept;
+    };
+}
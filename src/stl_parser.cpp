@@ -0,0 +1,208 @@
+#include "stl_parser.hpp"
+#include "mapped_file.hpp"
+#include "util.hpp"
+
+#include <meshoptimizer/meshoptimizer.h>
+
+#include <cfloat>
+#include <cstring>
+
+namespace d3d12_mesh_shaders {
+    static const size_t _HEADER_SIZE = 84;
+    static const size_t _TRIANGLE_SIZE = 50;
+
+    static const size_t _TRIANGLE_BATCH_SIZE = 1 << 14;
+
+    struct cell final {
+        int64_t x;
+        int64_t y;
+        int64_t z;
+
+        [[nodiscard]] inline bool operator==(const cell& other) const noexcept {
+            return x == other.x && y == other.y && z == other.z;
+        }
+    };
+
+    static inline uint32_t hash_cell(const cell& cell) noexcept {
+        auto hash = static_cast<uint64_t>(cell.x) * 0x9e3779b97f4a7c15ull ^ static_cast<uint64_t>(cell.y) * 0xc2b2ae3d27d4eb4full
+                  ^ static_cast<uint64_t>(cell.z) * 0x165667b19e3779f9ull;
+        hash ^= hash >> 32;
+        return static_cast<uint32_t>(hash);
+    }
+
+    stl_parser::stl_parser(const std::string_view& path, float weld_tolerance, float crease_angle) noexcept {
+        const mapped_file file(path);
+        if(!file.is_open()) {
+            util::panic("mapped_file");
+        }
+
+        _source_bytes = file.get_size();
+
+        const auto* data = file.get_data();
+        const auto size = file.get_size();
+
+        uint32_t triangle_count = 0;
+        if(size >= _HEADER_SIZE) {
+            memcpy(&triangle_count, data + 80, sizeof(uint32_t));
+        }
+
+        if(size < _HEADER_SIZE || _HEADER_SIZE + triangle_count * _TRIANGLE_SIZE != size) {
+            util::panic("stl_parser: not a binary STL file");
+        }
+
+        const auto corner_count = static_cast<size_t>(triangle_count) * 3;
+
+        std::vector<glm::vec3> corners(corner_count);
+        util::parallel_for(triangle_count, _TRIANGLE_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                // skip the stored facet normal, it is frequently garbage and gets rebuilt below anyway
+                memcpy(&corners[i * 3], data + _HEADER_SIZE + i * _TRIANGLE_SIZE + sizeof(glm::vec3), 3 * sizeof(glm::vec3));
+            }
+        });
+
+        auto min = glm::vec3(FLT_MAX), max = glm::vec3(-FLT_MAX);
+        for(const auto& corner : corners) {
+            min = glm::min(min, corner);
+            max = glm::max(max, corner);
+        }
+
+        const auto extent = corner_count ? glm::max(max.x - min.x, glm::max(max.y - min.y, max.z - min.z)) : 0.0f;
+        const auto tolerance = std::max(extent * weld_tolerance, FLT_MIN);
+
+        // Cells are twice the tolerance wide, so any position within tolerance lies in one of the 2x2x2 cells around the
+        // query that are closest to it.
+        const auto cell_size = 2.0f * tolerance;
+
+        size_t table_size = 1;
+        while(table_size < corner_count + corner_count / 4) {
+            table_size *= 2;
+        }
+
+        std::vector<uint32_t> table(table_size, ~0u);
+        std::vector<cell> cells;
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> position_indices(corner_count);
+
+        for(size_t i = 0; i < corner_count; i++) {
+            const auto& corner = corners[i];
+
+            const auto scaled = (corner - min) / cell_size;
+            const auto base = glm::floor(scaled);
+            const auto home = cell { static_cast<int64_t>(base.x), static_cast<int64_t>(base.y), static_cast<int64_t>(base.z) };
+            const auto direction = glm::ivec3(glm::sign(scaled - base - 0.5f));
+
+            auto match = ~0u;
+            for(uint32_t neighbour = 0; neighbour < 8 && match == ~0u; neighbour++) {
+                const auto query = cell {
+                    home.x + ((neighbour & 1) ? direction.x : 0),
+                    home.y + ((neighbour & 2) ? direction.y : 0),
+                    home.z + ((neighbour & 4) ? direction.z : 0)
+                };
+
+                auto bucket = hash_cell(query) & (table_size - 1);
+                for(size_t probe = 1; table[bucket] != ~0u; probe++) {
+                    const auto candidate = table[bucket];
+                    if(cells[candidate] == query && glm::all(glm::lessThanEqual(glm::abs(positions[candidate] - corner), glm::vec3(tolerance)))) {
+                        match = candidate;
+                        break;
+                    }
+
+                    bucket = (bucket + probe) & (table_size - 1);
+                }
+            }
+
+            if(match == ~0u) {
+                match = static_cast<uint32_t>(positions.size());
+
+                auto bucket = hash_cell(home) & (table_size - 1);
+                for(size_t probe = 1; table[bucket] != ~0u; probe++) {
+                    bucket = (bucket + probe) & (table_size - 1);
+                }
+
+                table[bucket] = match;
+                cells.push_back(home);
+                positions.push_back(corner);
+            }
+
+            position_indices[i] = match;
+        }
+
+        std::vector<uint32_t>().swap(table);
+        std::vector<cell>().swap(cells);
+        std::vector<glm::vec3>().swap(corners);
+
+        std::vector<glm::vec3> face_normals(triangle_count);
+        std::vector<float> corner_angles(corner_count);
+
+        util::parallel_for(triangle_count, _TRIANGLE_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                const auto& a = positions[position_indices[i * 3]];
+                const auto& b = positions[position_indices[i * 3 + 1]];
+                const auto& c = positions[position_indices[i * 3 + 2]];
+
+                const auto normal = glm::cross(b - a, c - a);
+                const auto length = glm::length(normal);
+                face_normals[i] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+
+                corner_angles[i * 3] = util::get_corner_angle(a, b, c);
+                corner_angles[i * 3 + 1] = util::get_corner_angle(b, c, a);
+                corner_angles[i * 3 + 2] = util::get_corner_angle(c, a, b);
+            }
+        });
+
+        // position -> incident corners, as offsets into one flat array
+        std::vector<uint32_t> adjacency_offsets(positions.size() + 1, 0);
+        for(const auto position_index : position_indices) {
+            adjacency_offsets[position_index + 1]++;
+        }
+
+        for(size_t i = 0; i < positions.size(); i++) {
+            adjacency_offsets[i + 1] += adjacency_offsets[i];
+        }
+
+        std::vector<uint32_t> adjacency(corner_count);
+        {
+            auto fill_offsets = adjacency_offsets;
+            for(size_t i = 0; i < corner_count; i++) {
+                adjacency[fill_offsets[position_indices[i]]++] = static_cast<uint32_t>(i);
+            }
+        }
+
+        const auto crease_cos = glm::cos(glm::radians(crease_angle));
+
+        std::vector<mesh::vertex> corner_vertices(corner_count);
+        util::parallel_for(triangle_count, _TRIANGLE_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                const auto& face_normal = face_normals[i];
+
+                for(size_t j = 0; j < 3; j++) {
+                    const auto position_index = position_indices[i * 3 + j];
+
+                    auto normal = glm::vec3(0.0f);
+                    for(auto k = adjacency_offsets[position_index]; k < adjacency_offsets[position_index + 1]; k++) {
+                        const auto corner = adjacency[k];
+                        const auto& other_normal = face_normals[corner / 3];
+
+                        if(glm::dot(face_normal, other_normal) >= crease_cos) {
+                            normal += corner_angles[corner] * other_normal;
+                        }
+                    }
+
+                    const auto length = glm::length(normal);
+                    corner_vertices[i * 3 + j] = mesh::vertex(positions[position_index], glm::vec2(0.0f), length > 0.0f ? normal / length : face_normal);
+                }
+            }
+        });
+
+        // Corners inside one smoothing region summed the same facets in the same order, so their normals are bit-identical
+        // and the remap merges them; corners across a crease stay split.
+        std::vector<uint32_t> remap(corner_count);
+        const auto vertex_count = meshopt_generateVertexRemap(remap.data(), nullptr, corner_count, corner_vertices.data(), corner_count, sizeof(mesh::vertex));
+
+        _vertices.resize(vertex_count);
+        _indices.resize(corner_count);
+
+        meshopt_remapVertexBuffer(_vertices.data(), corner_vertices.data(), corner_count, sizeof(mesh::vertex), remap.data());
+        meshopt_remapIndexBuffer(_indices.data(), nullptr, corner_count, remap.data());
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace d3d12_mesh_shaders {
+    // Reader for binary STL. STL stores three unshared corners per facet, so positions are welded with a quantized spatial
+    // hash first and normals are rebuilt from the welded topology: angle-weighted across facets that meet at less than the
+    // crease angle, flat across everything sharper. Corners that end up identical are merged into one vertex.
+    class stl_parser final {
+    private:
+        std::vector<mesh::vertex> _vertices;
+        std::vector<uint32_t> _indices;
+
+        size_t _source_bytes;
+
+    public:
+        stl_parser(const std::string_view& path, float weld_tolerance, float crease_angle) noexcept;
+
+        [[nodiscard]] inline std::vector<mesh::vertex>& get_vertices() noexcept {
+            return _vertices;
+        }
+
+        [[nodiscard]] inline std::vector<uint32_t>& get_indices() noexcept {
+            return _indices;
+        }
+
+        [[nodiscard]] inline size_t get_source_bytes() const noexcept {
+            return _source_bytes;
+        }
+    };
+}
@@ -0,0 +1,137 @@
+#include "tangent_generator.hpp"
+#include "util.hpp"
+
+#include <array>
+
+namespace d3d12_mesh_shaders {
+    static const size_t _TRIANGLE_BATCH_SIZE = 1 << 14;
+    static const size_t _VERTEX_BATCH_SIZE = 1 << 14;
+
+    static const float _OCTAHEDRAL_SCALE = 32767.0f;
+
+    struct corner_tangent final {
+        glm::vec3 tangent;
+        float handedness;
+    };
+
+    // any unit vector perpendicular to the normal, for vertices whose UVs give no direction
+    static inline glm::vec3 get_fallback_tangent(const glm::vec3& normal) noexcept {
+        const auto axis = glm::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        return glm::normalize(glm::cross(axis, normal));
+    }
+
+    static inline uint32_t pack_tangent(const glm::vec3& tangent, float handedness) noexcept {
+        auto octahedral = glm::vec2(tangent) / (glm::abs(tangent.x) + glm::abs(tangent.y) + glm::abs(tangent.z));
+        if(tangent.z < 0.0f) {
+            const auto sign = glm::vec2(octahedral.x >= 0.0f ? 1.0f : -1.0f, octahedral.y >= 0.0f ? 1.0f : -1.0f);
+            octahedral = (1.0f - glm::abs(glm::vec2(octahedral.y, octahedral.x))) * sign;
+        }
+
+        const auto quantized = glm::uvec2(glm::round((glm::clamp(octahedral, -1.0f, 1.0f) * 0.5f + 0.5f) * _OCTAHEDRAL_SCALE));
+        return quantized.x | quantized.y << 15 | (handedness < 0.0f ? 1u << 31 : 0u);
+    }
+
+    glm::vec4 unpack_tangent(uint32_t tangent) noexcept {
+        const auto octahedral = glm::vec2(tangent & 0x7fff, (tangent >> 15) & 0x7fff) / _OCTAHEDRAL_SCALE * 2.0f - 1.0f;
+
+        auto result = glm::vec3(octahedral, 1.0f - glm::abs(octahedral.x) - glm::abs(octahedral.y));
+        if(result.z < 0.0f) {
+            const auto sign = glm::vec2(result.x >= 0.0f ? 1.0f : -1.0f, result.y >= 0.0f ? 1.0f : -1.0f);
+            result = glm::vec3((1.0f - glm::abs(glm::vec2(result.y, result.x))) * sign, result.z);
+        }
+
+        return glm::vec4(glm::normalize(result), (tangent >> 31) ? -1.0f : 1.0f);
+    }
+
+    std::vector<uint32_t> generate_tangents(const std::vector<mesh::vertex>& vertices, const std::vector<uint32_t>& indices) noexcept {
+        const auto vertex_count = vertices.size();
+        const auto index_count = indices.size();
+        const auto triangle_count = index_count / 3;
+
+        // Every corner writes only its own slot, and every vertex later reads only its own corners, so neither pass needs
+        // locks or atomics.
+        std::vector<corner_tangent> corner_tangents(index_count);
+        util::parallel_for(triangle_count, _TRIANGLE_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                const auto& v0 = vertices[indices[i * 3]];
+                const auto& v1 = vertices[indices[i * 3 + 1]];
+                const auto& v2 = vertices[indices[i * 3 + 2]];
+
+                const auto edge_1 = v1.position - v0.position, edge_2 = v2.position - v0.position;
+                const auto delta_1 = v1.tex_coord - v0.tex_coord, delta_2 = v2.tex_coord - v0.tex_coord;
+
+                // twice the signed UV area; its sign says whether the UV mapping is mirrored on this face
+                const auto signed_area = delta_1.x * delta_2.y - delta_2.x * delta_1.y;
+                const auto face_tangent = edge_1 * delta_2.y - edge_2 * delta_1.y;
+                const auto handedness = signed_area < 0.0f ? -1.0f : 1.0f;
+
+                const std::array<float, 3> angles = {
+                    util::get_corner_angle(v0.position, v1.position, v2.position),
+                    util::get_corner_angle(v1.position, v2.position, v0.position),
+                    util::get_corner_angle(v2.position, v0.position, v1.position)
+                };
+
+                for(size_t j = 0; j < 3; j++) {
+                    const auto& normal = vertices[indices[i * 3 + j]].normal;
+
+                    auto& corner = corner_tangents[i * 3 + j];
+                    corner = corner_tangent { glm::vec3(0.0f), 0.0f };
+
+                    if(signed_area == 0.0f) {
+                        continue;
+                    }
+
+                    const auto projected = handedness * (face_tangent - normal * glm::dot(normal, face_tangent));
+                    const auto length = glm::length(projected);
+
+                    if(length > 0.0f) {
+                        corner = corner_tangent { projected / length * angles[j], handedness * angles[j] };
+                    }
+                }
+            }
+        });
+
+        // vertex -> incident corners, as offsets into one flat array
+        std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+        for(const auto index : indices) {
+            adjacency_offsets[index + 1]++;
+        }
+
+        for(size_t i = 0; i < vertex_count; i++) {
+            adjacency_offsets[i + 1] += adjacency_offsets[i];
+        }
+
+        std::vector<uint32_t> adjacency(index_count);
+        {
+            auto fill_offsets = adjacency_offsets;
+            for(size_t i = 0; i < index_count; i++) {
+                adjacency[fill_offsets[indices[i]]++] = static_cast<uint32_t>(i);
+            }
+        }
+
+        std::vector<uint32_t> tangents(vertex_count);
+        util::parallel_for(vertex_count, _VERTEX_BATCH_SIZE, [&](size_t begin, size_t end) noexcept {
+            for(auto i = begin; i < end; i++) {
+                auto tangent = glm::vec3(0.0f);
+                auto handedness = 0.0f;
+
+                for(auto j = adjacency_offsets[i]; j < adjacency_offsets[i + 1]; j++) {
+                    const auto& corner = corner_tangents[adjacency[j]];
+
+                    tangent += corner.tangent;
+                    handedness += corner.handedness;
+                }
+
+                const auto& normal = vertices[i].normal;
+
+                // re-orthogonalize, the sum of projected tangents can drift off the plane for non-unit normals
+                tangent -= normal * glm::dot(normal, tangent);
+
+                const auto length = glm::length(tangent);
+                tangents[i] = pack_tangent(length > 0.0f ? tangent / length : get_fallback_tangent(normal), handedness);
+            }
+        });
+
+        return tangents;
+    }
+}
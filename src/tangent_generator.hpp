@@ -0,0 +1,16 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace d3d12_mesh_shaders {
+    // Builds one tangent frame per vertex from the UV derivatives of the triangles around it, weighted the way MikkTSpace
+    // weights them: each face tangent is projected into the vertex normal's plane, normalized and scaled by the corner
+    // angle. The frame is packed into 32 bits: the tangent as 15 bit unorm octahedral x (bits 0-14) and y (bits 15-29),
+    // and the bitangent sign in bit 31 (set means bitangent = -cross(normal, tangent)).
+    std::vector<uint32_t> generate_tangents(const std::vector<mesh::vertex>& vertices, const std::vector<uint32_t>& indices) noexcept;
+
+    [[nodiscard]] glm::vec4 unpack_tangent(uint32_t tangent) noexcept;
+}
@@ -1,11 +1,16 @@
 #pragma once
 
+#include "scratch_arena.hpp"
+
 #include <d3d12.h>
 #include <D3D12MemAlloc/D3D12MemAlloc.h>
 #include <glm/glm.hpp>
 
-#include <vector>
+#include <algorithm>
+#include <atomic>
 #include <string_view>
+#include <thread>
+#include <vector>
 
 namespace d3d12_mesh_shaders {
     template<typename T, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE Type>
@@ -33,6 +38,47 @@ namespace d3d12_mesh_shaders {
 
         std::vector<int8_t> read_binary_file(const std::string_view& path) noexcept;
 
+        // 0 leaves one worker per hardware thread; meshlet_analyzer --threads pins it to measure how the build scales
+        inline std::atomic<size_t> _num_worker_threads = 0;
+
+        inline void set_num_worker_threads(size_t num_threads) noexcept {
+            _num_worker_threads.store(num_threads, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] inline size_t get_num_worker_threads() noexcept {
+            const auto num_threads = _num_worker_threads.load(std::memory_order_relaxed);
+            return num_threads > 0 ? num_threads : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+
+        // Calls function(begin, end) for consecutive batches of [0, num_items) on all hardware threads, the calling thread included.
+        // The workers count their scratch against the calling thread's scratch_arena::scope.
+        template<typename Function>
+        void parallel_for(size_t num_items, size_t batch_size, Function&& function) noexcept {
+            const auto num_batches = (num_items + batch_size - 1) / batch_size;
+            const auto num_threads = std::min(num_batches, get_num_worker_threads());
+
+            std::atomic<size_t> next_batch = 0;
+            const auto run_batches = [&]() noexcept {
+                for(auto batch = next_batch++; batch < num_batches; batch = next_batch++) {
+                    const auto begin = batch * batch_size;
+                    function(begin, std::min(begin + batch_size, num_items));
+                }
+            };
+
+            auto* scratch_scope = scratch_arena::scope::get_current();
+
+            std::vector<std::jthread> threads;
+            threads.reserve(num_threads);
+            for(size_t i = 1; i < num_threads; i++) {
+                threads.emplace_back([&]() noexcept {
+                    scratch_arena::scope::set_current(scratch_scope);
+                    run_batches();
+                });
+            }
+
+            run_batches();
+        }
+
         inline glm::mat4 reverse_depth_projection_matrix_lh(float field_of_view, float aspect_ratio, float near_plane, float far_plane) noexcept {
             const auto tan_half_fov_y = glm::tan(glm::radians(field_of_view) / 2.0f);
             const auto far_minus_near = far_plane - near_plane;
@@ -47,6 +93,14 @@ namespace d3d12_mesh_shaders {
             return result;
         }
 
+        // angle at corner of the triangle (corner, a, b), the weight of that triangle in angle-weighted vertex averages
+        inline float get_corner_angle(const glm::vec3& corner, const glm::vec3& a, const glm::vec3& b) noexcept {
+            const auto edge_a = a - corner, edge_b = b - corner;
+
+            const auto length = glm::length(edge_a) * glm::length(edge_b);
+            return length > 0.0f ? glm::acos(glm::clamp(glm::dot(edge_a, edge_b) / length, -1.0f, 1.0f)) : 0.0f;
+        }
+
         inline glm::vec3 direction_from_rotation(const glm::vec3& rotation) noexcept {
             const auto cos_y = glm::cos(rotation.y);
 
@@ -0,0 +1,125 @@
+#include "mesh.hpp"
+#include "mesh_analysis.hpp"
+#include "util.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+using namespace d3d12_mesh_shaders;
+
+template<typename T>
+static T parse_argument(int& i, int num_arguments, char** arguments) noexcept {
+    if(++i >= num_arguments) {
+        util::panic("meshlet_analyzer: missing value for option");
+    }
+
+    T value {};
+    const auto* end = arguments[i] + std::strlen(arguments[i]);
+    if(std::from_chars(arguments[i], end, value).ptr != end) {
+        util::panic("meshlet_analyzer: invalid option value");
+    }
+
+    return value;
+}
+
+static void print_timings(const mesh& asset) noexcept {
+    const auto& statistics = asset.get_statistics();
+    std::cerr << util::get_num_worker_threads() << " threads: parsed " << statistics.source_bytes / (1024 * 1024) << " MB in "
+              << statistics.parse_seconds * 1000.0 << " ms (" << statistics.get_parse_throughput() << " MB/s), welded in "
+              << statistics.weld_seconds * 1000.0 << " ms, built in " << statistics.total_seconds * 1000.0 << " ms" << std::endl;
+}
+
+// meshlet_analyzer <asset> [--max-vertices N] [--max-triangles N] [--cone-weight W] [--clusterizer greedy|graph|scan|both] [--serial] [--no-merge] [--no-group] [--no-optimize] [--cluster-lod] [--lod-levels N] [--shadow-meshlets] [--preview] [--threads N]
+// Builds the asset like the renderer would and prints the mesh_analysis report as JSON to stdout. With "both" the asset is
+// built once per clusterizer and the reports are keyed by clusterizer name. The import and build times go to stderr, so
+// --threads N, which pins the worker count of the parallel passes, shows how they scale.
+int main(int num_arguments, char** arguments) {
+    if(num_arguments < 2) {
+        std::cerr << "usage: meshlet_analyzer <asset> [--max-vertices N] [--max-triangles N] [--cone-weight W] [--clusterizer greedy|graph|scan|both] [--serial] [--no-merge] [--no-group] [--no-optimize] [--cluster-lod] [--lod-levels N] [--shadow-meshlets] [--preview] [--threads N]" << std::endl;
+        return 1;
+    }
+
+    mesh::build_options options;
+    auto compare_clusterizers = false;
+
+    for(int i = 2; i < num_arguments; i++) {
+        const std::string_view option = arguments[i];
+
+        if(option == "--max-vertices") {
+            options.meshlets.max_vertices = parse_argument<uint32_t>(i, num_arguments, arguments);
+            options.use_tuning_file = false;
+        } else if(option == "--max-triangles") {
+            options.meshlets.max_triangles = parse_argument<uint32_t>(i, num_arguments, arguments);
+            options.use_tuning_file = false;
+        } else if(option == "--cone-weight") {
+            options.meshlets.cone_weight = parse_argument<float>(i, num_arguments, arguments);
+            options.use_tuning_file = false;
+        } else if(option == "--clusterizer") {
+            if(++i >= num_arguments) {
+                util::panic("meshlet_analyzer: missing value for option");
+            }
+
+            options.use_tuning_file = false;
+
+            const std::string_view clusterizer = arguments[i];
+            if(clusterizer == "greedy") {
+                options.meshlets.clusterizer = mesh::meshlet_clusterizer::greedy;
+            } else if(clusterizer == "graph") {
+                options.meshlets.clusterizer = mesh::meshlet_clusterizer::graph;
+            } else if(clusterizer == "scan") {
+                options.meshlets.clusterizer = mesh::meshlet_clusterizer::scan;
+            } else if(clusterizer == "both") {
+                compare_clusterizers = true;
+            } else {
+                util::panic("meshlet_analyzer: unknown clusterizer");
+            }
+        } else if(option == "--serial") {
+            options.parallel_meshlet_build = false;
+        } else if(option == "--no-merge") {
+            options.merge_small_meshlets = false;
+        } else if(option == "--no-group") {
+            options.group_meshlets = false;
+        } else if(option == "--no-optimize") {
+            options.optimize_meshlets = false;
+        } else if(option == "--cluster-lod") {
+            options.build_cluster_lod = true;
+        } else if(option == "--shadow-meshlets") {
+            options.build_shadow_meshlets = true;
+        } else if(option == "--preview") {
+            options.quality = mesh::build_quality::preview;
+        } else if(option == "--lod-levels") {
+            options.lod_level_count = parse_argument<uint32_t>(i, num_arguments, arguments);
+        } else if(option == "--threads") {
+            const auto num_threads = parse_argument<size_t>(i, num_arguments, arguments);
+            if(num_threads == 0) {
+                util::panic("meshlet_analyzer: invalid option value");
+            }
+
+            util::set_num_worker_threads(num_threads);
+        } else {
+            util::panic("meshlet_analyzer: unknown option");
+        }
+    }
+
+    if(!compare_clusterizers) {
+        const mesh asset(arguments[1], options);
+        print_timings(asset);
+        std::cout << mesh_analysis(asset).to_json() << std::endl;
+
+        return 0;
+    }
+
+    options.meshlets.clusterizer = mesh::meshlet_clusterizer::greedy;
+    const mesh greedy_asset(arguments[1], options);
+    print_timings(greedy_asset);
+    std::cout << "{\"greedy\":" << mesh_analysis(greedy_asset).to_json();
+
+    options.meshlets.clusterizer = mesh::meshlet_clusterizer::graph;
+    const mesh graph_asset(arguments[1], options);
+    print_timings(graph_asset);
+    std::cout << ",\"graph\":" << mesh_analysis(graph_asset).to_json() << "}" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include "mesh.hpp"
+#include "meshlet_bvh.hpp"
+#include "meshlet_culler.hpp"
+#include "util.hpp"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace d3d12_mesh_shaders;
+
+static const float _SPACING = 1.0f;
+static const uint32_t _VIEW_COUNT = 8;
+static const uint32_t _REPETITIONS = 4;
+
+static inline float get_terrain_height(float x, float z) noexcept {
+    return glm::sin(x * 0.05f) * glm::cos(z * 0.07f) * 8.0f;
+}
+
+static uint32_t compact_morton_bits(uint32_t value) noexcept {
+    value &= 0x55555555u;
+    value = (value | value >> 1) & 0x33333333u;
+    value = (value | value >> 2) & 0x0f0f0f0fu;
+    value = (value | value >> 4) & 0x00ff00ffu;
+    value = (value | value >> 8) & 0x0000ffffu;
+    return value;
+}
+
+// Meshlets tiling rolling terrain in Morton order, so every group of 32 covers an 8 by 4 block of cells like the groups of
+// a cooked mesh cover compact regions; cones point roughly up with random spreads.
+static std::vector<mesh::meshlet_bounds> generate_terrain(size_t meshlet_count, float& side) noexcept {
+    std::vector<mesh::meshlet_bounds> meshlet_bounds(meshlet_count);
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> tilt(-0.4f, 0.4f);
+    std::uniform_int_distribution<int> cutoff(30, 120);
+
+    uint32_t cells = 1;
+    while(static_cast<size_t>(cells) * cells < meshlet_count) {
+        cells *= 2;
+    }
+
+    side = static_cast<float>(cells) * _SPACING;
+
+    for(size_t i = 0; i < meshlet_count; i++) {
+        const auto x = static_cast<float>(compact_morton_bits(static_cast<uint32_t>(i))) * _SPACING;
+        const auto z = static_cast<float>(compact_morton_bits(static_cast<uint32_t>(i) >> 1)) * _SPACING;
+
+        auto& bounds = meshlet_bounds[i];
+        bounds.center = glm::vec3(x, get_terrain_height(x, z), z);
+        bounds.radius = _SPACING * 0.75f;
+        bounds.cone_apex = bounds.center;
+
+        const auto axis = glm::normalize(glm::vec3(tilt(random), 1.0f, tilt(random))) * 127.0f;
+        bounds.cone_axis[0] = static_cast<int8_t>(axis.x);
+        bounds.cone_axis[1] = static_cast<int8_t>(axis.y);
+        bounds.cone_axis[2] = static_cast<int8_t>(axis.z);
+        bounds.cone_cutoff = static_cast<int8_t>(cutoff(random));
+    }
+
+    return meshlet_bounds;
+}
+
+static void run(size_t meshlet_count) noexcept {
+    float side;
+    const auto meshlet_bounds = generate_terrain(meshlet_count, side);
+
+    const auto build_start = std::chrono::steady_clock::now();
+
+    std::vector<mesh::meshlet_bvh_node> nodes;
+    build_meshlet_bvh(meshlet_bounds, nodes);
+
+    const auto build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+
+    double flat_seconds = 0.0, bvh_seconds = 0.0;
+    size_t visible_count = 0, node_tests = 0, meshlet_tests = 0;
+
+    std::vector<uint32_t> flat_visible, bvh_visible;
+
+    // a camera a little above the terrain in the middle of the filled half, turning in place and seeing an eighth of the side
+    const auto position = glm::vec3(side * 0.5f, get_terrain_height(side * 0.5f, side * 0.25f) + 2.0f, side * 0.25f);
+    const auto projection = util::reverse_depth_projection_matrix_lh(60.0f, 16.0f / 9.0f, 0.1f, side * 0.125f);
+
+    for(uint32_t view = 0; view < _VIEW_COUNT; view++) {
+        const auto angle = static_cast<float>(view) * glm::two_pi<float>() / _VIEW_COUNT;
+        const auto direction = glm::vec3(glm::sin(angle), -0.1f, glm::cos(angle));
+        const meshlet_culler culler(projection * glm::lookAt(position, position + direction, glm::vec3(0.0f, 1.0f, 0.0f)), position);
+
+        for(uint32_t repetition = 0; repetition < _REPETITIONS; repetition++) {
+            const auto flat_start = std::chrono::steady_clock::now();
+            static_cast<void>(culler.cull(meshlet_bounds, flat_visible));
+
+            const auto bvh_start = std::chrono::steady_clock::now();
+            const auto result = culler.cull(nodes, meshlet_bounds, bvh_visible);
+
+            const auto bvh_end = std::chrono::steady_clock::now();
+
+            flat_seconds += std::chrono::duration<double>(bvh_start - flat_start).count();
+            bvh_seconds += std::chrono::duration<double>(bvh_end - bvh_start).count();
+
+            if(repetition == 0) {
+                visible_count += result.visible_meshlet_count;
+                node_tests += result.node_tests;
+                meshlet_tests += result.meshlet_tests;
+            }
+        }
+
+        std::sort(bvh_visible.begin(), bvh_visible.end());
+        if(bvh_visible != flat_visible) {
+            util::panic("meshlet_bvh_benchmark: the BVH query and the flat scan disagree");
+        }
+    }
+
+    const auto frames = static_cast<double>(_VIEW_COUNT * _REPETITIONS);
+
+    std::cout << meshlet_count << " meshlets: " << nodes.size() << " nodes built in " << build_seconds * 1000.0 << " ms, "
+              << static_cast<double>(visible_count) / _VIEW_COUNT << " visible per frame ("
+              << 100.0 * static_cast<double>(visible_count) / (static_cast<double>(meshlet_count) * _VIEW_COUNT) << "%), flat scan "
+              << flat_seconds / frames * 1000.0 << " ms, BVH " << bvh_seconds / frames * 1000.0 << " ms with "
+              << node_tests / _VIEW_COUNT << " box and " << meshlet_tests / _VIEW_COUNT << " meshlet tests per frame ("
+              << flat_seconds / std::max(bvh_seconds, 1e-9) << "x)" << std::endl;
+}
+
+// meshlet_bvh_benchmark [meshlet counts...]
+// Times the flat meshlet scan of meshlet_culler against its BVH query over synthetic terrain, 1K, 100K and 10M meshlets
+// unless counts are given.
+int main(int num_arguments, char** arguments) {
+    std::vector<size_t> meshlet_counts;
+    for(int i = 1; i < num_arguments; i++) {
+        size_t count = 0;
+        const auto* end = arguments[i] + std::strlen(arguments[i]);
+        if(std::from_chars(arguments[i], end, count).ptr != end || count == 0) {
+            util::panic("meshlet_bvh_benchmark: invalid meshlet count");
+        }
+
+        meshlet_counts.push_back(count);
+    }
+
+    if(meshlet_counts.empty()) {
+        meshlet_counts = { 1000, 100000, 10000000 };
+    }
+
+    for(const auto count : meshlet_counts) {
+        run(count);
+    }
+
+    return 0;
+}